@@ -0,0 +1,188 @@
+/*
+  ==============================================================================
+
+    ADAAKernels.h
+
+    First-order antiderivative anti-aliasing (ADAA) for the models that have
+    a closed-form antiderivative F of their transfer curve f. Instead of f(x)
+    each sample outputs the average of f between the previous and current
+    input,
+
+        y[n] = (F(x[n]) - F(x[n-1])) / (x[n] - x[n-1])
+
+    which is far less prone to aliasing, at the cost of a half-sample delay
+    and a gentle high-frequency roll-off. When two inputs are too close for
+    the division to be trusted, f is evaluated at their midpoint instead.
+
+    Everything is computed in double: F grows with |x|, so the difference
+    above cancels badly in float. Tube has no closed-form antiderivative
+    (its curve is nested), so getKernel() returns nullptr for it and the
+    caller should fall back to the plain kernels.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace ADAAKernels
+{
+    constexpr double k = 2.0 / juce::MathConstants<double>::pi;
+
+    // below this input step, (F1 - F0) / dx is dominated by rounding, so use f at the midpoint
+    constexpr double tolerance = 1.0e-6;
+
+    /** Antiderivative of atan(t): t atan(t) - ln(1 + t^2) / 2. */
+    inline double atanIntegral (double t) noexcept
+    {
+        return t * std::atan (t) - 0.5 * std::log1p (t * t);
+    }
+
+    //==============================================================================
+    // the same curves as DistortionKernels, with d the drive gain
+
+    // k atan(6dx)
+    struct SoftClip
+    {
+        static double shape (double x, double d) noexcept         { return k * std::atan (6.0 * d * x); }
+        static double antiderivative (double x, double d) noexcept
+        {
+            const auto a = 6.0 * d;
+            return k * atanIntegral (a * x) / a;
+        }
+    };
+
+    // clamp(dx, -1, 1)
+    struct HardClip
+    {
+        static double shape (double x, double d) noexcept         { return juce::jlimit (-1.0, 1.0, d * x); }
+        static double antiderivative (double x, double d) noexcept
+        {
+            const auto y = d * x;
+
+            if (std::abs (y) <= 1.0)
+                return 0.5 * d * x * x;
+
+            return std::abs (x) - 0.5 / d;
+        }
+    };
+
+    // k atan(6d (max(dx + 0.15, 0) - 0.15)): k atan(6d^2 x) above x0 = -0.15/d, constant below it
+    struct HalfWave
+    {
+        static double shape (double x, double d) noexcept
+        {
+            return k * std::atan (6.0 * d * (juce::jmax (d * x + 0.15, 0.0) - 0.15));
+        }
+
+        static double antiderivative (double x, double d) noexcept
+        {
+            const auto b = 6.0 * d * d;
+            const auto x0 = -0.15 / d;
+
+            if (x >= x0)
+                return k * atanIntegral (b * x) / b;
+
+            return k * atanIntegral (b * x0) / b + shape (x0, d) * (x - x0);
+        }
+    };
+
+    // k atan(6d (|dx + 0.1| - 0.1)): k atan(6d^2 x) above x0 = -0.1/d, -k atan(6d^2 x + 1.2d) below it
+    struct FullWave
+    {
+        static double shape (double x, double d) noexcept
+        {
+            return k * std::atan (6.0 * d * (std::abs (d * x + 0.1) - 0.1));
+        }
+
+        static double antiderivative (double x, double d) noexcept
+        {
+            const auto b = 6.0 * d * d;
+            const auto c = 1.2 * d;
+            const auto x0 = -0.1 / d;
+            const auto upper = k * atanIntegral (b * x0) / b;
+
+            if (x >= x0)
+                return k * atanIntegral (b * x) / b;
+
+            return upper - k * (atanIntegral (b * x + c) - atanIntegral (b * x0 + c)) / b;
+        }
+    };
+
+    // sin(dx / 2)
+    struct Sine
+    {
+        static double shape (double x, double d) noexcept          { return std::sin (0.5 * d * x); }
+        static double antiderivative (double x, double d) noexcept { return -std::cos (0.5 * d * x) / (0.5 * d); }
+    };
+
+    //==============================================================================
+    /** Per-channel history. A default constructed state starts from silence. */
+    struct ChannelState
+    {
+        double x1 = 0.0;
+        double F1 = 0.0;
+        double drive = -1.0; // drive F1 was computed with; F1 is recomputed whenever it changes
+    };
+
+    /** Shapes one contiguous channel in place. If driveRamp isn't null it holds one drive per sample,
+        otherwise drive is used throughout.
+    */
+    template <typename SampleType>
+    using Kernel = void (*) (SampleType* data, int numSamples, const SampleType* driveRamp, SampleType drive, ChannelState& state);
+
+    template <typename Model, typename SampleType>
+    void processChannel (SampleType* data, int numSamples, const SampleType* driveRamp, SampleType drive, ChannelState& state) noexcept
+    {
+        auto x1 = state.x1;
+        auto F1 = state.F1;
+        auto lastDrive = state.drive;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const auto d = static_cast<double> (driveRamp != nullptr ? driveRamp[i] : drive);
+            const auto x = static_cast<double> (data[i]);
+
+            // both ends of the difference must come from the same curve
+            if (d != lastDrive)
+            {
+                F1 = Model::antiderivative (x1, d);
+                lastDrive = d;
+            }
+
+            const auto F = Model::antiderivative (x, d);
+            const auto dx = x - x1;
+
+            const auto y = std::abs (dx) > tolerance ? (F - F1) / dx
+                                                     : Model::shape (0.5 * (x + x1), d);
+
+            data[i] = static_cast<SampleType> (y);
+            x1 = x;
+            F1 = F;
+        }
+
+        state.x1 = x1;
+        state.F1 = F1;
+        state.drive = lastDrive;
+    }
+
+    /** Returns the ADAA kernel for a model index, in the same order as the "model" parameter choices,
+        or nullptr for models without a closed-form antiderivative (Tube).
+    */
+    template <typename SampleType>
+    Kernel<SampleType> getKernel (int modelIndex) noexcept
+    {
+        static constexpr Kernel<SampleType> kernels[] =
+        {
+            &processChannel<SoftClip, SampleType>,
+            &processChannel<HardClip, SampleType>,
+            nullptr,
+            &processChannel<HalfWave, SampleType>,
+            &processChannel<FullWave, SampleType>,
+            &processChannel<Sine, SampleType>
+        };
+
+        return kernels[juce::jlimit (0, (int) std::size (kernels) - 1, modelIndex)];
+    }
+}
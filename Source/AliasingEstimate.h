@@ -0,0 +1,144 @@
+/*
+  ==============================================================================
+
+    AliasingEstimate.h
+
+    A cheap prediction of how loud the aliasing of a block will be at each
+    oversampling factor, for the automatic oversampling mode.
+
+    The input is reduced to two numbers: its peak, and a frequency from the
+    ratio of the energy of its first difference to its own energy. For a
+    sine at w radians per sample that ratio is 2 (1 - cos w). For anything
+    broader, it leans towards the highest part of the spectrum. That is the
+    part that matters here, so it errs on the safe side.
+
+    Each model then gets a harmonic series for a sine at that peak and
+    drive. The series is exact for soft clip and sine fold, and a bound for
+    the rest. Running at N times the rate, harmonic k of a sine at f (as a
+    fraction of the host rate) is only heard once k f passes N - 1/2. Below
+    that, it either fits or folds into the band the down-sampler removes.
+    The level of the first harmonic past that point is the prediction.
+
+    It is a model, not a measurement. The threshold it is compared with
+    should be set by ear, or with the quality analysis tool.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "DistortionParameters.h"
+
+namespace AliasingEstimate
+{
+    /** What the prediction needs to know about a block. */
+    struct InputMeasure
+    {
+        double peak = 0.0;
+        double frequency = 0.0;   // cycles per sample at the host rate, 0 to 0.5
+    };
+
+    /** Peak and difference-energy frequency of a block, over every channel. lastSamples holds each
+        channel's last sample from the block before, for the first difference, and is updated to this
+        block's. Every sample counts, so even a one-sample block is measured.
+    */
+    template <typename SampleType>
+    InputMeasure measure (const juce::dsp::AudioBlock<SampleType>& block, SampleType* lastSamples) noexcept
+    {
+        double energy = 0.0;
+        double differenceEnergy = 0.0;
+        double peak = 0.0;
+
+        for (size_t ch = 0; ch < block.getNumChannels(); ++ch)
+        {
+            const SampleType* data = block.getChannelPointer (ch);
+            auto previous = static_cast<double> (lastSamples[ch]);
+
+            for (size_t sample = 0; sample < block.getNumSamples(); ++sample)
+            {
+                const auto x = static_cast<double> (data[sample]);
+                const auto difference = x - previous;
+                energy += x * x;
+                differenceEnergy += difference * difference;
+                peak = juce::jmax (peak, std::abs (x));
+                previous = x;
+            }
+
+            if (block.getNumSamples() > 0)
+                lastSamples[ch] = data[block.getNumSamples() - 1];
+        }
+
+        InputMeasure result;
+        result.peak = peak;
+
+        if (energy > 0.0)
+        {
+            const auto cosine = juce::jlimit (-1.0, 1.0, 1.0 - 0.5 * differenceEnergy / energy);
+            result.frequency = std::acos (cosine) / juce::MathConstants<double>::twoPi;
+        }
+
+        return result;
+    }
+
+    /** Level of harmonic k, relative to full scale, for a sine of amplitude peak through the model at this drive. */
+    inline double getHarmonicLevel (DisModels model, double drive, double peak, int k) noexcept
+    {
+        // atan (b sin t) has harmonics 2 q^k / k with q = (sqrt (1 + b^2) - 1) / b, scaled here by the 2 / pi output gain
+        const auto softClip = [k] (double b)
+        {
+            if (b <= 0.0)
+                return 0.0;
+
+            const auto q = (std::sqrt (1.0 + b * b) - 1.0) / b;
+            return 4.0 / juce::MathConstants<double>::pi * std::pow (q, k) / k;
+        };
+
+        // clipping a sine at 1 / a of its peak. Towards a square wave the harmonics go as 4 / (pi k)
+        const auto hardClip = [k] (double a)
+        {
+            return a <= 1.0 ? 0.0 : 4.0 / juce::MathConstants<double>::pi * (1.0 - 1.0 / a) / k;
+        };
+
+        // a rectifier's corner, whose harmonics fall as 1 / k^2
+        const auto rectifier = [k] (double a)
+        {
+            return 4.0 / juce::MathConstants<double>::pi * juce::jmin (1.0, a) / (static_cast<double> (k) * k);
+        };
+
+        const auto a = peak * drive;
+
+        switch (model)
+        {
+            case DisModels::kSoft:      return softClip (6.0 * a);
+            case DisModels::kHard:      return hardClip (a);
+            case DisModels::kTube:      return juce::jmax (softClip (6.0 * a * drive), hardClip (a * drive));
+            case DisModels::kHalfWave:
+            case DisModels::kFullWave:  return juce::jmax (softClip (6.0 * a * drive), rectifier (a));
+            case DisModels::kSine:
+            {
+                // sin (b sin t) has harmonics 2 J_k (b), and J_k (b) is about (b / 2)^k / k! once k passes b
+                const auto b = 0.5 * a;
+
+                if (b <= 0.0)
+                    return 0.0;
+
+                return juce::jmin (1.0, 2.0 * std::exp (k * std::log (0.5 * b) - std::lgamma (k + 1.0)));
+            }
+        }
+
+        return 0.0;
+    }
+
+    /** Predicted aliasing in dBFS at this oversampling factor (1 for none). */
+    inline double predict (DisModels model, double drive, const InputMeasure& input, int factor) noexcept
+    {
+        if (input.peak <= 0.0 || input.frequency <= 0.0)
+            return -200.0;
+
+        // the first harmonic that folds back below the host Nyquist. Past a million, nothing is left of any series
+        const auto k = static_cast<int> (juce::jmin (1.0e6, std::floor ((factor - 0.5) / input.frequency))) + 1;
+
+        return juce::Decibels::gainToDecibels (getHarmonicLevel (model, drive, input.peak, k), -200.0);
+    }
+}
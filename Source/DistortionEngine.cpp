@@ -0,0 +1,635 @@
+/*
+  ==============================================================================
+
+    DistortionEngine.cpp
+
+  ==============================================================================
+*/
+
+#include "DistortionEngine.h"
+
+//==============================================================================
+template <typename SampleType>
+DistortionEngine<SampleType>::DistortionEngine (WaveshaperTable& tableToUse)
+    : waveshaperTable (tableToUse)
+{
+    // the table only matches the full-band model and drive, so it's only ever given to stage 0
+    stages[0].setWaveshaperTable(&waveshaperTable);
+}
+
+template <typename SampleType>
+void DistortionEngine<SampleType>::prepare (const juce::dsp::ProcessSpec& spec, const DistortionParameters& newParams)
+{
+    params = newParams;
+    sampleRate = spec.sampleRate;
+
+    for (int index = 0; index < maxBands; ++index)
+    {
+        stages[static_cast<size_t>(index)].prepare(spec, getStageParameters(index));
+        stageRunning[static_cast<size_t>(index)] = false;
+    }
+
+    previousNumBands = params.numBands;
+
+    // the dry delays can be as long as the slowest configuration
+    int maxLatency = 0;
+
+    for (int filter = 0; filter < 2; ++filter)
+        for (int factor = 0; factor < Stage::numOversamplingFactors; ++factor)
+            maxLatency = juce::jmax(maxLatency, stages[0].getOversamplingLatency(factor, filter));
+
+    dryDelay.setMaximumDelayInSamples(maxLatency);
+    dryDelay.prepare(spec);
+
+    for (auto& delay : bandDryDelays)
+    {
+        delay.setMaximumDelayInSamples(maxLatency);
+        delay.prepare(spec);
+    }
+
+    reportedLatency = -1;
+    updateLatency();
+
+    // smoothing starts from the current values, so nothing ramps on the first block
+    mix.reset(sampleRate, 0.05);
+    mix.setCurrentAndTargetValue(getGlobalMix());
+    phaseGain.reset(sampleRate, 0.01);
+    phaseGain.setCurrentAndTargetValue(params.phase ? -1 : 1);
+    preFilter.prepare(spec, ToneFilter<SampleType>::Type::kHighPass, params.preCutoff, params.preFilter && ! isPreFilterFused());
+    postFilter.prepare(spec, ToneFilter<SampleType>::Type::kLowPass, params.postCutoff, params.postFilter && ! isPostFilterFused());
+
+    // crossover tree. The split uses both outputs of each crossover, so its type doesn't matter
+    for (int crossover = 0; crossover < maxCrossovers; ++crossover)
+    {
+        const auto frequency = params.crossovers[static_cast<size_t>(crossover)];
+
+        crossovers[static_cast<size_t>(crossover)].prepare(spec);
+        crossovers[static_cast<size_t>(crossover)].setCutoffFrequency(frequency);
+        crossoverFrequency[static_cast<size_t>(crossover)].reset(sampleRate, 0.05);
+        crossoverFrequency[static_cast<size_t>(crossover)].setCurrentAndTargetValue(frequency);
+
+        for (int band = 0; band < crossover; ++band)
+        {
+            auto& allpass = allpasses[static_cast<size_t>(band)][static_cast<size_t>(crossover)];
+            allpass.prepare(spec);
+            allpass.setType(juce::dsp::LinkwitzRileyFilterType::allpass);
+            allpass.setCutoffFrequency(frequency);
+        }
+    }
+
+    for (int band = 0; band < maxBands; ++band)
+    {
+        const auto& settings = params.bands[static_cast<size_t>(band)];
+        bandMix[static_cast<size_t>(band)].reset(sampleRate, 0.05);
+        bandMix[static_cast<size_t>(band)].setCurrentAndTargetValue(settings.bypass ? 0 : settings.mix);
+    }
+
+    // every working buffer, the stages' included, in one allocation: sized by a first pass, handed out by a second
+    scratchArena.beginLayout();
+    allocateScratch(spec);
+    scratchArena.allocate();
+    allocateScratch(spec);
+
+    silentSamples = 0;
+    idle = false;
+    updateTail();
+}
+
+template <typename SampleType>
+void DistortionEngine<SampleType>::allocateScratch (const juce::dsp::ProcessSpec& spec)
+{
+    const auto numChannels = static_cast<size_t>(spec.numChannels);
+    const auto samplesPerBlock = static_cast<size_t>(spec.maximumBlockSize);
+
+    // the dry/wet blends
+    dryScratch = scratchArena.allocateBlock<SampleType>(numChannels, samplesPerBlock);
+    dryGain = scratchArena.allocateArray<SampleType>(samplesPerBlock);
+    wetGain = scratchArena.allocateArray<SampleType>(samplesPerBlock);
+
+    // multiband mode
+    for (auto& bandBlock : bandScratch)
+        bandBlock = scratchArena.allocateBlock<SampleType>(numChannels, samplesPerBlock);
+
+    bandDryScratch = scratchArena.allocateBlock<SampleType>(numChannels, samplesPerBlock);
+    bandDryGain = scratchArena.allocateArray<SampleType>(samplesPerBlock);
+    bandWetGain = scratchArena.allocateArray<SampleType>(samplesPerBlock);
+
+    // tone filter fades. Filters only use it inside their own process(), one after the other,
+    // so every filter shares it, the ones fused into the stages included
+    filterScratch = scratchArena.allocateBlock<SampleType>(numChannels, juce::jmax(samplesPerBlock, static_cast<size_t>(Stage::fusedChunkSize)));
+    preFilter.setFadeScratch(filterScratch);
+    postFilter.setFadeScratch(filterScratch);
+
+    for (auto& stage : stages)
+        stage.allocateScratch(scratchArena, filterScratch);
+}
+
+//==============================================================================
+template <typename SampleType>
+void DistortionEngine<SampleType>::process (juce::dsp::AudioBlock<SampleType>& block, const DistortionParameters& newParams)
+{
+    params = newParams;
+    mix.setTargetValue(getGlobalMix());
+    phaseGain.setTargetValue(params.phase ? -1 : 1);
+    // a fused filter fades out here while its twin in the stage fades in, so moving it doesn't click
+    preFilter.setTarget(params.preCutoff, params.preFilter && ! isPreFilterFused());
+    postFilter.setTarget(params.postCutoff, params.postFilter && ! isPostFilterFused());
+
+    for (int crossover = 0; crossover < maxCrossovers; ++crossover)
+        crossoverFrequency[static_cast<size_t>(crossover)].setTargetValue(params.crossovers[static_cast<size_t>(crossover)]);
+
+    // bypass is a fade to fully dry, so it doesn't click
+    for (int band = 0; band < maxBands; ++band)
+    {
+        const auto& settings = params.bands[static_cast<size_t>(band)];
+        bandMix[static_cast<size_t>(band)].setTargetValue(settings.bypass ? 0 : settings.mix);
+    }
+
+    const auto numSamples = static_cast<int>(block.getNumSamples());
+    jassert(numSamples <= static_cast<int>(dryScratch.getNumSamples()));
+
+    stats = {};
+    stats.numSamples = numSamples;
+    stats.numChannels = static_cast<int>(block.getNumChannels());
+
+    // a change in the number of bands rearranges the stages, so they and the crossovers start again from clean state
+    if (params.numBands != previousNumBands)
+    {
+        previousNumBands = params.numBands;
+        stageRunning.fill(false);
+
+        for (auto& delay : bandDryDelays)
+            delay.reset();
+
+        for (auto& crossover : crossovers)
+            crossover.reset();
+
+        for (auto& bandAllpasses : allpasses)
+            for (auto& allpass : bandAllpasses)
+                allpass.reset();
+    }
+
+    // idle tracks cost a scan of the input and nothing else
+    updateLatency();
+    updateTail();
+
+    // the input peak comes for free from the same scan, but the scan can stop early when nobody's measuring
+    bool silent;
+
+    if (measuring)
+    {
+        stats.inputPeak = static_cast<float>(Stage::getPeak(block));
+        silent = stats.inputPeak < Stage::silenceThreshold;
+    }
+    else
+    {
+        silent = Stage::isSilent(block);
+    }
+
+    if (silent)
+    {
+        const auto wasDecayed = silentSamples >= tailSamples;
+        silentSamples = juce::jmin(silentSamples + numSamples, std::numeric_limits<int>::max() / 2);
+
+        if (wasDecayed)
+        {
+            skipIdleBlock(block);
+            stats.idle = true;
+            return;
+        }
+    }
+    else
+    {
+        silentSamples = 0;
+
+        if (idle)
+            flushState();
+    }
+
+    // pre tone
+    const auto preFilterStart = readClock();
+    preFilter.process(block);
+    stats.preFilterTicks = readClock() - preFilterStart;
+
+    // dry signal stored, delayed by the reported latency so it lines up with the wet path
+    auto dryBlock = dryScratch.getSubsetChannelBlock(0, block.getNumChannels())
+                                                                 .getSubBlock(0, block.getNumSamples());
+    dryBlock.copyFrom(block);
+
+    if (reportedLatency > 0)
+        dryDelay.process(juce::dsp::ProcessContextReplacing<SampleType>(dryBlock));
+
+    if (params.numBands > 1)
+        processBands(block);
+    else
+        processStage(0, block);
+
+    // dry/wet mix and phase flip, folded into one gain for each path
+    if (mix.isSmoothing() || phaseGain.isSmoothing())
+    {
+        // gains advance once per sample and are shared by all channels
+        for (int sample = 0; sample < numSamples; ++sample)
+        {
+            const auto wet = mix.getNextValue();
+            const auto polarity = phaseGain.getNextValue();
+            wetGain[sample] = wet * polarity;
+            dryGain[sample] = (1 - wet) * polarity;
+        }
+
+        for (size_t ch = 0; ch < block.getNumChannels(); ++ch)
+        {
+            SampleType* data = block.getChannelPointer(ch);
+            juce::FloatVectorOperations::multiply(data, wetGain, numSamples);
+            juce::FloatVectorOperations::addWithMultiply(data, dryBlock.getChannelPointer(ch), dryGain, numSamples);
+        }
+    }
+    else
+    {
+        // nothing moving, so constant gains, and the default full wet, in phase setting costs nothing
+        const auto wet = mix.getTargetValue() * phaseGain.getTargetValue();
+        const auto dry = (1 - mix.getTargetValue()) * phaseGain.getTargetValue();
+
+        for (size_t ch = 0; ch < block.getNumChannels(); ++ch)
+        {
+            SampleType* data = block.getChannelPointer(ch);
+
+            if (wet != SampleType(1))
+                juce::FloatVectorOperations::multiply(data, wet, numSamples);
+
+            if (dry != SampleType(0))
+                juce::FloatVectorOperations::addWithMultiply(data, dryBlock.getChannelPointer(ch), dry, numSamples);
+        }
+    }
+
+    // post tone
+    const auto postFilterStart = readClock();
+    postFilter.process(block);
+    stats.postFilterTicks = readClock() - postFilterStart;
+
+    if (measuring)
+        measureOutput(block);
+}
+
+template <typename SampleType>
+void DistortionEngine<SampleType>::setMeasuring (bool shouldMeasure) noexcept
+{
+    measuring = shouldMeasure;
+
+    for (auto& stage : stages)
+        stage.setMeasuring(shouldMeasure);
+}
+
+template <typename SampleType>
+void DistortionEngine<SampleType>::measureOutput (const juce::dsp::AudioBlock<SampleType>& block) noexcept
+{
+    for (auto& stage : stages)
+    {
+        const auto timings = stage.takeTimings();
+        stats.upsampleTicks += timings.upsampleTicks;
+        stats.shapeTicks += timings.shapeTicks;
+        stats.downsampleTicks += timings.downsampleTicks;
+    }
+
+    // peak, mean square and samples over 0 dBFS, in one pass over each channel
+    SampleType peak = 0;
+    SampleType sumOfSquares = 0;
+    int clipped = 0;
+
+    for (size_t ch = 0; ch < block.getNumChannels(); ++ch)
+    {
+        const SampleType* data = block.getChannelPointer(ch);
+
+        for (size_t sample = 0; sample < block.getNumSamples(); ++sample)
+        {
+            const auto magnitude = std::abs(data[sample]);
+            peak = juce::jmax(peak, magnitude);
+            sumOfSquares += magnitude * magnitude;
+            clipped += magnitude > SampleType(1) ? 1 : 0;
+        }
+    }
+
+    const auto numValues = block.getNumChannels() * block.getNumSamples();
+    stats.outputPeak = static_cast<float>(peak);
+    stats.outputMeanSquare = numValues > 0 ? static_cast<float>(sumOfSquares / static_cast<SampleType>(numValues)) : 0.0f;
+    stats.clippedSamples = clipped;
+}
+
+//==============================================================================
+template <typename SampleType>
+void DistortionEngine<SampleType>::processStage (int index, juce::dsp::AudioBlock<SampleType>& block)
+{
+    auto& stage = stages[static_cast<size_t>(index)];
+    const auto stageParams = getStageParameters(index);
+
+    // whatever the stage held from before it sat out is stale, so it starts from silence at its current settings
+    if (! stageRunning[static_cast<size_t>(index)])
+    {
+        stage.skip(stageParams);
+        stage.reset();
+        stageRunning[static_cast<size_t>(index)] = true;
+    }
+
+    stage.process(block, stageParams);
+}
+
+template <typename SampleType>
+void DistortionEngine<SampleType>::processBands (juce::dsp::AudioBlock<SampleType>& block)
+{
+    const auto numChannels = block.getNumChannels();
+    const auto numSamples = static_cast<int>(block.getNumSamples());
+
+    splitBands(block);
+
+    auto bandDryBlock = bandDryScratch.getSubsetChannelBlock(0, numChannels)
+                                                                         .getSubBlock(0, block.getNumSamples());
+    block.clear();
+
+    for (int band = 0; band < params.numBands; ++band)
+    {
+        auto bandBlock = bandScratch[static_cast<size_t>(band)].getSubsetChannelBlock(0, numChannels)
+                                                                                                  .getSubBlock(0, block.getNumSamples());
+        auto& gain = bandMix[static_cast<size_t>(band)];
+
+        // the band's dry signal, lined up with its stage's output before either gain touches it. The delay
+        // runs even while the band is fully wet, so its history is there when the mix comes down
+        bandDryBlock.copyFrom(bandBlock);
+
+        if (reportedLatency > 0)
+            bandDryDelays[static_cast<size_t>(band)].process(juce::dsp::ProcessContextReplacing<SampleType>(bandDryBlock));
+
+        if (gain.isSmoothing())
+        {
+            for (int sample = 0; sample < numSamples; ++sample)
+            {
+                const auto wet = gain.getNextValue();
+                bandWetGain[sample] = wet;
+                bandDryGain[sample] = 1 - wet;
+            }
+
+            processBandStage(band, bandBlock, bandDryBlock);
+
+            for (size_t ch = 0; ch < numChannels; ++ch)
+            {
+                juce::FloatVectorOperations::addWithMultiply(block.getChannelPointer(ch), bandBlock.getChannelPointer(ch), bandWetGain, numSamples);
+                juce::FloatVectorOperations::addWithMultiply(block.getChannelPointer(ch), bandDryBlock.getChannelPointer(ch), bandDryGain, numSamples);
+            }
+
+            continue;
+        }
+
+        const auto wet = gain.getTargetValue();
+
+        if (wet != SampleType(1))
+        {
+            for (size_t ch = 0; ch < numChannels; ++ch)
+                juce::FloatVectorOperations::addWithMultiply(block.getChannelPointer(ch), bandDryBlock.getChannelPointer(ch), 1 - wet, numSamples);
+        }
+
+        // a bypassed band, or one mixed fully dry, is never shaped or oversampled
+        if (wet == SampleType(0))
+        {
+            stageRunning[static_cast<size_t>(band)] = false;
+            continue;
+        }
+
+        processBandStage(band, bandBlock, bandDryBlock);
+
+        for (size_t ch = 0; ch < numChannels; ++ch)
+        {
+            if (wet == SampleType(1))
+                juce::FloatVectorOperations::add(block.getChannelPointer(ch), bandBlock.getChannelPointer(ch), numSamples);
+            else
+                juce::FloatVectorOperations::addWithMultiply(block.getChannelPointer(ch), bandBlock.getChannelPointer(ch), wet, numSamples);
+        }
+    }
+}
+
+template <typename SampleType>
+void DistortionEngine<SampleType>::processBandStage (int band, juce::dsp::AudioBlock<SampleType>& block, const juce::dsp::AudioBlock<SampleType>& dryBlock)
+{
+    const auto index = static_cast<size_t>(band);
+
+    // a band coming back from bypass restarts from silence, so its stage has nothing real to give until the
+    // latency has passed. Until then the wet side carries the band's delayed dry signal, which keeps the sum whole
+    if (! stageRunning[index])
+        bandWarmUp[index] = reportedLatency;
+
+    processStage(band, block);
+
+    if (bandWarmUp[index] > 0)
+    {
+        const auto length = juce::jmin(bandWarmUp[index], static_cast<int>(block.getNumSamples()));
+
+        for (size_t ch = 0; ch < block.getNumChannels(); ++ch)
+            juce::FloatVectorOperations::copy(block.getChannelPointer(ch), dryBlock.getChannelPointer(ch), length);
+
+        bandWarmUp[index] -= length;
+    }
+}
+
+template <typename SampleType>
+void DistortionEngine<SampleType>::splitBands (const juce::dsp::AudioBlock<SampleType>& block)
+{
+    const auto numBands = params.numBands;
+    const auto numSamples = block.getNumSamples();
+
+    for (size_t start = 0; start < numSamples; start += cutoffUpdateInterval)
+    {
+        const auto length = juce::jmin(static_cast<size_t>(cutoffUpdateInterval), numSamples - start);
+
+        // crossovers follow their smoothers the way the tone filters do, with new coefficients every few samples
+        for (int crossover = 0; crossover < numBands - 1; ++crossover)
+        {
+            const auto frequency = crossoverFrequency[static_cast<size_t>(crossover)].skip(static_cast<int>(length));
+
+            if (crossovers[static_cast<size_t>(crossover)].getCutoffFrequency() != frequency)
+            {
+                crossovers[static_cast<size_t>(crossover)].setCutoffFrequency(frequency);
+
+                for (int band = 0; band < crossover; ++band)
+                    allpasses[static_cast<size_t>(band)][static_cast<size_t>(crossover)].setCutoffFrequency(frequency);
+            }
+        }
+
+        for (size_t ch = 0; ch < block.getNumChannels(); ++ch)
+        {
+            const SampleType* input = block.getChannelPointer(ch);
+            std::array<SampleType*, maxBands> outputs {};
+
+            for (int band = 0; band < numBands; ++band)
+                outputs[static_cast<size_t>(band)] = bandScratch[static_cast<size_t>(band)].getChannelPointer(ch);
+
+            // each crossover splits off a band from the highs left by the one below. The bands already
+            // split off go through its allpass, so they stay in phase with everything above them
+            for (auto sample = start; sample < start + length; ++sample)
+            {
+                auto rest = input[sample];
+
+                for (int crossover = 0; crossover < numBands - 1; ++crossover)
+                {
+                    for (int band = 0; band < crossover; ++band)
+                    {
+                        auto& output = outputs[static_cast<size_t>(band)][sample];
+                        output = allpasses[static_cast<size_t>(band)][static_cast<size_t>(crossover)].processSample(static_cast<int>(ch), output);
+                    }
+
+                    SampleType low, high;
+                    crossovers[static_cast<size_t>(crossover)].processSample(static_cast<int>(ch), rest, low, high);
+                    outputs[static_cast<size_t>(crossover)][sample] = low;
+                    rest = high;
+                }
+
+                outputs[static_cast<size_t>(numBands - 1)][sample] = rest;
+            }
+        }
+    }
+}
+
+template <typename SampleType>
+StageParameters DistortionEngine<SampleType>::getStageParameters (int band) const noexcept
+{
+    StageParameters stage;
+    stage.osFactorIndex = params.osFactorIndex;
+    stage.osFilterIndex = params.osFilterIndex;
+    stage.precision = params.precision;
+    stage.autoOversample = params.autoOversample;
+    stage.aliasThreshold = params.aliasThreshold;
+
+    if (params.numBands <= 1)
+    {
+        stage.model = params.model;
+        stage.drive = params.drive;
+        stage.oversample = params.oversample;
+        stage.engine = params.engine;
+        stage.fusePreFilter = isPreFilterFused();
+        stage.fusePostFilter = isPostFilterFused();
+        stage.preFilter = params.preFilter;
+        stage.preCutoff = params.preCutoff;
+        stage.postFilter = params.postFilter;
+        stage.postCutoff = params.postCutoff;
+        stage.numChainStages = params.numChainStages;
+        stage.chain = params.chain;
+        return stage;
+    }
+
+    const auto& settings = params.bands[static_cast<size_t>(band)];
+    stage.model = settings.model;
+    stage.drive = settings.drive;
+    stage.oversample = settings.oversample;
+
+    // the table is built for the full-band model and drive, so bands use the kernels unless ADAA is chosen
+    stage.engine = params.engine == Engine::kADAA ? Engine::kADAA : Engine::kDirect;
+    return stage;
+}
+
+template <typename SampleType>
+bool DistortionEngine<SampleType>::isPreFilterFused() const noexcept
+{
+    return params.tonePlacement == TonePlacement::kPrePostOversampled && isAlwaysOversampled();
+}
+
+template <typename SampleType>
+bool DistortionEngine<SampleType>::isPostFilterFused() const noexcept
+{
+    return params.tonePlacement != TonePlacement::kHostRate && isAlwaysOversampled();
+}
+
+template <typename SampleType>
+bool DistortionEngine<SampleType>::isAlwaysOversampled() const noexcept
+{
+    // automatic oversampling can drop to the host rate, where there's no oversampled pass to fuse into
+    return params.oversample && ! params.autoOversample && params.numBands <= 1;
+}
+
+//==============================================================================
+template <typename SampleType>
+void DistortionEngine<SampleType>::updateTail() noexcept
+{
+    // the crossovers are Linkwitz-Riley too, and the lowest rings longest. The oversampling filters sit far above
+    // the audio band and settle well inside the margin
+    constexpr double margin = 0.005;
+
+    const auto ringSeconds = [&] (bool enabled, float cutoff)
+    {
+        return enabled ? ToneFilter<SampleType>::getRingSeconds(cutoff) : 0.0;
+    };
+
+    const auto ring = juce::jmax(ringSeconds(params.preFilter, params.preCutoff),
+                                 ringSeconds(params.postFilter, params.postCutoff),
+                                 ringSeconds(params.numBands > 1, params.crossovers[0]));
+
+    tailSamples = reportedLatency + static_cast<int>(std::ceil((ring + margin) * sampleRate));
+}
+
+template <typename SampleType>
+void DistortionEngine<SampleType>::skipIdleBlock (juce::dsp::AudioBlock<SampleType>& block) noexcept
+{
+    block.clear();
+    idle = true;
+
+    // nothing can be heard moving, so parameters jump straight to their targets
+    mix.setCurrentAndTargetValue(mix.getTargetValue());
+    phaseGain.setCurrentAndTargetValue(phaseGain.getTargetValue());
+    preFilter.skip();
+    postFilter.skip();
+
+    for (auto& frequency : crossoverFrequency)
+        frequency.setCurrentAndTargetValue(frequency.getTargetValue());
+
+    for (auto& gain : bandMix)
+        gain.setCurrentAndTargetValue(gain.getTargetValue());
+
+    for (int index = 0; index < maxBands; ++index)
+        stages[static_cast<size_t>(index)].skip(getStageParameters(index));
+}
+
+template <typename SampleType>
+void DistortionEngine<SampleType>::flushState() noexcept
+{
+    // everything has rung down to below the silence threshold, so clearing it is inaudible and drops any denormal residue
+    // or state frozen in a filter that was switched off
+    dryDelay.reset();
+    bandWarmUp.fill(0);
+
+    for (auto& delay : bandDryDelays)
+        delay.reset();
+
+    preFilter.reset();
+    postFilter.reset();
+
+    for (auto& crossover : crossovers)
+        crossover.reset();
+
+    for (auto& bandAllpasses : allpasses)
+        for (auto& allpass : bandAllpasses)
+            allpass.reset();
+
+    for (auto& stage : stages)
+        stage.reset();
+
+    idle = false;
+}
+
+//==============================================================================
+template <typename SampleType>
+void DistortionEngine<SampleType>::updateLatency()
+{
+    // the selected factor and filter set the latency whether oversampling is on or not, so toggling it keeps host PDC in sync
+    const auto latency = stages[0].getOversamplingLatency(params.osFactorIndex, params.osFilterIndex);
+
+    if (latency == reportedLatency)
+        return;
+
+    reportedLatency = latency;
+    dryDelay.setDelay(static_cast<SampleType>(reportedLatency));
+
+    for (auto& delay : bandDryDelays)
+        delay.setDelay(static_cast<SampleType>(reportedLatency));
+
+    for (auto& stage : stages)
+        stage.setLatency(reportedLatency);
+}
+
+//==============================================================================
+template class DistortionEngine<float>;
+template class DistortionEngine<double>;
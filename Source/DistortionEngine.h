@@ -0,0 +1,165 @@
+/*
+  ==============================================================================
+
+    DistortionEngine.h
+
+    The whole signal path (tone filters, the shaping stages, latency
+    compensation and the dry/wet blend) as one class templated on the sample
+    type, so the processor can run float and double buffers through the
+    same code. Instantiated for float and double in DistortionEngine.cpp.
+
+    The tone filters can also run inside the stage's oversampled pass, where
+    they go over each up-sampled chunk along with the shaper while it's in
+    cache. The post low-pass then also cleans up the harmonics before the
+    down-sampler. With the pre high-pass fused, the dry signal is taken
+    before it.
+
+    In multiband mode the signal is split by a tree of Linkwitz-Riley
+    crossovers, each band gets its own stage and mix, and the bands are
+    summed again. Every band below a crossover also goes through that
+    crossover's allpass, so all bands share one phase response and the sum
+    of untouched bands is flat.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "DistortionParameters.h"
+#include "DistortionStage.h"
+#include "ToneFilter.h"
+#include "WaveshaperTable.h"
+
+//==============================================================================
+/**
+*/
+template <typename SampleType>
+class DistortionEngine
+{
+public:
+    /** The lookup table is shared, since it's built from the parameters rather than the audio. */
+    explicit DistortionEngine (WaveshaperTable& tableToUse);
+
+    /** Allocates everything for this spec and starts from the given parameters without ramping. */
+    void prepare (const juce::dsp::ProcessSpec& spec, const DistortionParameters& params);
+
+    /** Processes a block in place. It must be no longer than the prepared maximum block size. */
+    void process (juce::dsp::AudioBlock<SampleType>& block, const DistortionParameters& params);
+
+    /** The latency every configuration is padded up to, which is what the host should compensate for. */
+    int getLatencySamples() const noexcept    { return reportedLatency; }
+
+    /** How long the output keeps going after the input stops: the latency plus the filters ringing down. */
+    double getTailLengthSeconds() const noexcept    { return sampleRate > 0 ? tailSamples / sampleRate : 0.0; }
+
+    /** Turns per-stage timing and the output level measurements on or off. */
+    void setMeasuring (bool shouldMeasure) noexcept;
+
+    /** What was measured over the last block. Empty apart from the sizes while not measuring. */
+    const BlockStats& getBlockStats() const noexcept    { return stats; }
+
+    static constexpr int maxBands = DistortionParameters::maxBands;
+    static constexpr int maxCrossovers = maxBands - 1;
+
+private:
+    //==============================================================================
+    using Stage = DistortionStage<SampleType>;
+    using CutoffSmoother = juce::SmoothedValue<SampleType, juce::ValueSmoothingTypes::Multiplicative>;
+
+    void updateLatency();
+
+    // takes every working buffer from the arena. Run once to size it and once more to hand out the memory
+    void allocateScratch (const juce::dsp::ProcessSpec& spec);
+
+    // stage settings for a band, or for the full band when multiband mode is off
+    StageParameters getStageParameters (int band) const noexcept;
+
+    // whether a tone filter runs in the stage's oversampled pass rather than here. That needs a single band
+    // that is oversampled all the time
+    bool isPreFilterFused() const noexcept;
+    bool isPostFilterFused() const noexcept;
+    bool isAlwaysOversampled() const noexcept;
+
+    // the band mixes replace the full-band one in multiband mode, so it stays fully wet there. The phase flip still applies
+    SampleType getGlobalMix() const noexcept    { return params.numBands > 1 ? SampleType (1) : static_cast<SampleType> (params.mix); }
+
+    // runs one stage, starting it from clean state if it sat out the blocks before
+    void processStage (int index, juce::dsp::AudioBlock<SampleType>& block);
+
+    // multiband mode: split, shape and mix each band, and sum them back into the block
+    void processBands (juce::dsp::AudioBlock<SampleType>& block);
+    void processBandStage (int band, juce::dsp::AudioBlock<SampleType>& block, const juce::dsp::AudioBlock<SampleType>& dryBlock);
+    void splitBands (const juce::dsp::AudioBlock<SampleType>& block);
+
+    // silence detection. Once the input has been silent for longer than the tail, the output is silent too,
+    // so the whole chain is skipped until audio comes back, and then restarted from clean state
+    void updateTail() noexcept;
+    void skipIdleBlock (juce::dsp::AudioBlock<SampleType>& block) noexcept;
+    void flushState() noexcept;
+
+    // instrumentation
+    void measureOutput (const juce::dsp::AudioBlock<SampleType>& block) noexcept;
+    juce::int64 readClock() const noexcept    { return measuring ? juce::Time::getHighResolutionTicks() : 0; }
+
+    bool measuring {false};
+    BlockStats stats;
+
+    double sampleRate {0.0};
+    int tailSamples {0};
+    int silentSamples {0};
+    bool idle {false};
+
+    //==============================================================================
+    WaveshaperTable& waveshaperTable;
+    DistortionParameters params;
+
+    // stage 0 covers the full band, or the lowest band in multiband mode
+    std::array<Stage, maxBands> stages;
+    std::array<bool, maxBands> stageRunning {};
+    int previousNumBands {1};
+
+    // the latency reported to the host. Every stage is padded up to it, so toggling oversampling never changes what the host compensates for
+    int reportedLatency {0};
+
+    // dry signal for the mix, delayed to line up with the wet path
+    juce::dsp::DelayLine<SampleType, juce::dsp::DelayLineInterpolationTypes::None> dryDelay;
+
+    // smoothed parameters. Mix and phase move every sample; the crossovers are log-smoothed
+    // and update their coefficients every cutoffUpdateInterval samples while they move
+    juce::SmoothedValue<SampleType> mix {1};
+    juce::SmoothedValue<SampleType> phaseGain {1};
+    static constexpr int cutoffUpdateInterval = 16;
+
+    ToneFilter<SampleType> preFilter;
+    ToneFilter<SampleType> postFilter;
+
+    // crossover tree, and the allpass each band below a crossover goes through: allpasses[band][crossover]
+    std::array<juce::dsp::LinkwitzRileyFilter<SampleType>, maxCrossovers> crossovers;
+    std::array<std::array<juce::dsp::LinkwitzRileyFilter<SampleType>, maxCrossovers>, maxBands> allpasses;
+    std::array<CutoffSmoother, maxCrossovers> crossoverFrequency;
+
+    // per band mix, which also fades bypass in and out. Each band's dry signal has its own delay, so
+    // both its gains are applied at output time, the way the full-band mix is
+    std::array<juce::SmoothedValue<SampleType>, maxBands> bandMix;
+    std::array<juce::dsp::AudioBlock<SampleType>, maxBands> bandScratch;
+    juce::dsp::AudioBlock<SampleType> bandDryScratch;
+    std::array<juce::dsp::DelayLine<SampleType, juce::dsp::DelayLineInterpolationTypes::None>, maxBands> bandDryDelays;
+    std::array<int, maxBands> bandWarmUp {};   // samples left before a restarted band's stage output is real
+    SampleType* bandWetGain = nullptr;
+    SampleType* bandDryGain = nullptr;
+
+    // dry copy and per-sample gains. Each ramp is computed once per block and shared by all channels
+    juce::dsp::AudioBlock<SampleType> dryScratch;
+    SampleType* dryGain = nullptr;
+    SampleType* wetGain = nullptr;
+
+    // fade space for every tone filter, the stages' included
+    juce::dsp::AudioBlock<SampleType> filterScratch;
+
+    // everything above, and the stages' working buffers, live in here
+    ScratchArena scratchArena;
+
+    //==============================================================================
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DistortionEngine)
+};
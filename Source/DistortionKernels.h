@@ -0,0 +1,342 @@
+/*
+  ==============================================================================
+
+    DistortionKernels.h
+
+    Block waveshaping kernels, one per distortion model. Each kernel walks a
+    single channel's contiguous buffer in one pass, so the model only has to
+    be chosen once per block rather than once per sample.
+
+    Every model is written once against the FastMath primitives and is then
+    run either through libm (Exact, the scalar reference) or through one of
+    the polynomial atan/sin tiers (High, Eco) a full SIMDRegister at a time.
+
+    Each kernel also comes in a ramp version that takes one drive value per
+    sample, for while the drive parameter is being smoothed.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "FastMath.h"
+
+// set to 0 to run the High and Eco kernels one sample at a time, e.g. when verifying the SIMD path
+#ifndef DISTORTION_USE_SIMD
+ #define DISTORTION_USE_SIMD JUCE_USE_SIMD
+#endif
+
+namespace DistortionKernels
+{
+    // softclip divisor. Creating this constexpr is more efficient than doing 2/pi for every sample in the audio block, because calculated at initialisation
+    template <typename SampleType>
+    constexpr SampleType piDivisor = static_cast<SampleType> (2.0 / juce::MathConstants<double>::pi);
+
+    //==============================================================================
+    // libm transcendentals, one sample at a time. This is the reference the fast paths are checked against
+    struct ReferenceMath
+    {
+        template <typename SampleType> static SampleType atan (SampleType x) noexcept { return std::atan (x); }
+        template <typename SampleType> static SampleType sin (SampleType x) noexcept  { return std::sin (x); }
+    };
+
+    // polynomial transcendentals that work on scalars and SIMDRegisters alike, below -120 dB error
+    struct HighMath
+    {
+        template <typename Vec> static Vec atan (Vec x) noexcept { return FastMath::atan (x); }
+        template <typename Vec> static Vec sin (Vec x) noexcept  { return FastMath::sin (x); }
+    };
+
+    // lower order versions of the above, around -75 dB error
+    struct EcoMath
+    {
+        template <typename Vec> static Vec atan (Vec x) noexcept { return FastMath::atanEco (x); }
+        template <typename Vec> static Vec sin (Vec x) noexcept  { return FastMath::sinEco (x); }
+    };
+
+    /** Accuracy of the transcendentals, in the same order as the "precision" parameter choices. */
+    enum class Precision
+    {
+        kExact,
+        kHigh,
+        kEco
+    };
+
+    //==============================================================================
+    // softclip algorithim (rounded)
+    template <typename Math>
+    struct SoftClip
+    {
+        template <typename Vec>
+        static Vec process (Vec x, Vec drive) noexcept
+        {
+            using E = FastMath::ElementType<Vec>;
+            return Math::atan (x * drive * static_cast<E> (6.0)) * piDivisor<E>;
+        }
+    };
+
+    // hardclip algorithim (any sample above 1 or -1 will be squared)
+    template <typename Math>
+    struct HardClip
+    {
+        template <typename Vec>
+        static Vec process (Vec x, Vec drive) noexcept
+        {
+            using E = FastMath::ElementType<Vec>;
+            return FastMath::min (FastMath::max (x * drive, FastMath::splat<Vec> (static_cast<E> (-1.0))),
+                                  FastMath::splat<Vec> (static_cast<E> (1.0)));
+        }
+    };
+
+    // tube algorithim (postive values will hardclip, negative values will softclip)
+    template <typename Math>
+    struct Tube
+    {
+        template <typename Vec>
+        static Vec process (Vec x, Vec drive) noexcept
+        {
+            x = x * drive;
+            x = FastMath::select (FastMath::lessThan (x, FastMath::splat<Vec> (0)),
+                                  SoftClip<Math>::process (x, drive),
+                                  HardClip<Math>::process (x, drive));
+
+            return SoftClip<Math>::process (x, drive);
+        }
+    };
+
+    // half wave rectification (negative values are set to zero)
+    template <typename Math>
+    struct HalfWave
+    {
+        template <typename Vec>
+        static Vec process (Vec x, Vec drive) noexcept
+        {
+            using E = FastMath::ElementType<Vec>;
+            constexpr auto bias = static_cast<E> (0.15);
+
+            x = FastMath::max (x * drive + bias, FastMath::splat<Vec> (0)) - bias;
+
+            return SoftClip<Math>::process (x, drive); // softclipping on the positive part of wave
+        }
+    };
+
+    // full wave retification (all negative values are mapped to corresponding positive values)
+    template <typename Math>
+    struct FullWave
+    {
+        template <typename Vec>
+        static Vec process (Vec x, Vec drive) noexcept
+        {
+            using E = FastMath::ElementType<Vec>;
+            constexpr auto bias = static_cast<E> (0.1);
+
+            x = FastMath::abs (x * drive + bias) - bias;
+
+            return SoftClip<Math>::process (x, drive);
+        }
+    };
+
+    // sine/fold over clipping with limiting output (0.5)
+    template <typename Math>
+    struct Sine
+    {
+        template <typename Vec>
+        static Vec process (Vec x, Vec drive) noexcept
+        {
+            using E = FastMath::ElementType<Vec>;
+            return Math::sin (x * drive * static_cast<E> (0.5));
+        }
+    };
+
+    //==============================================================================
+    /** Shapes one contiguous channel in place. */
+    template <typename SampleType>
+    using Kernel = void (*) (SampleType* data, int numSamples, SampleType drive);
+
+    template <typename Shaper, typename SampleType>
+    void processChannel (SampleType* data, int numSamples, SampleType drive) noexcept
+    {
+        for (int i = 0; i < numSamples; ++i)
+            data[i] = Shaper::process (data[i], drive);
+    }
+
+    /** Shapes one contiguous channel in place, with a separate drive for every sample. */
+    template <typename SampleType>
+    using RampKernel = void (*) (SampleType* data, const SampleType* drive, int numSamples);
+
+    template <typename Shaper, typename SampleType>
+    void processChannelRamp (SampleType* data, const SampleType* drive, int numSamples) noexcept
+    {
+        for (int i = 0; i < numSamples; ++i)
+            data[i] = Shaper::process (data[i], drive[i]);
+    }
+
+   #if JUCE_USE_SIMD
+    /** Same as processChannel, but a whole register at a time. The unaligned head
+        and the tail go through the same shaper one sample at a time, so every
+        sample sees identical maths.
+    */
+    template <typename Shaper, typename SampleType>
+    void processChannelSIMD (SampleType* data, int numSamples, SampleType drive) noexcept
+    {
+        using Vec = juce::dsp::SIMDRegister<SampleType>;
+        constexpr auto width = static_cast<int> (Vec::SIMDNumElements);
+
+        const auto head = juce::jmin (numSamples, static_cast<int> (Vec::getNextSIMDAlignedPtr (data) - data));
+        int i = 0;
+
+        for (; i < head; ++i)
+            data[i] = Shaper::process (data[i], drive);
+
+        const auto vDrive = Vec::expand (drive);
+
+        for (; i + width <= numSamples; i += width)
+            Shaper::process (Vec::fromRawArray (data + i), vDrive).copyToRawArray (data + i);
+
+        for (; i < numSamples; ++i)
+            data[i] = Shaper::process (data[i], drive);
+    }
+
+    /** Same as processChannelRamp, a register at a time. The drive ramp needn't share the data's alignment. */
+    template <typename Shaper, typename SampleType>
+    void processChannelRampSIMD (SampleType* data, const SampleType* drive, int numSamples) noexcept
+    {
+        using Vec = juce::dsp::SIMDRegister<SampleType>;
+        constexpr auto width = static_cast<int> (Vec::SIMDNumElements);
+
+        const auto head = juce::jmin (numSamples, static_cast<int> (Vec::getNextSIMDAlignedPtr (data) - data));
+        int i = 0;
+
+        for (; i < head; ++i)
+            data[i] = Shaper::process (data[i], drive[i]);
+
+        alignas (Vec::SIMDRegisterSize) SampleType driveLanes[width];
+
+        for (; i + width <= numSamples; i += width)
+        {
+            std::copy (drive + i, drive + i + width, driveLanes);
+            Shaper::process (Vec::fromRawArray (data + i), Vec::fromRawArray (driveLanes)).copyToRawArray (data + i);
+        }
+
+        for (; i < numSamples; ++i)
+            data[i] = Shaper::process (data[i], drive[i]);
+    }
+   #endif
+
+    //==============================================================================
+    template <typename SampleType, template <typename> class Shaper, typename Math>
+    constexpr Kernel<SampleType> makeKernel() noexcept
+    {
+       #if DISTORTION_USE_SIMD
+        return &processChannelSIMD<Shaper<Math>, SampleType>;
+       #else
+        return &processChannel<Shaper<Math>, SampleType>;
+       #endif
+    }
+
+    template <typename SampleType, template <typename> class Shaper, typename Math>
+    constexpr RampKernel<SampleType> makeRampKernel() noexcept
+    {
+       #if DISTORTION_USE_SIMD
+        return &processChannelRampSIMD<Shaper<Math>, SampleType>;
+       #else
+        return &processChannelRamp<Shaper<Math>, SampleType>;
+       #endif
+    }
+
+    template <typename SampleType, typename Math>
+    Kernel<SampleType> getApproximateKernel (int modelIndex) noexcept
+    {
+        static constexpr Kernel<SampleType> kernels[] =
+        {
+            makeKernel<SampleType, SoftClip, Math>(),
+            makeKernel<SampleType, HardClip, Math>(),
+            makeKernel<SampleType, Tube, Math>(),
+            makeKernel<SampleType, HalfWave, Math>(),
+            makeKernel<SampleType, FullWave, Math>(),
+            makeKernel<SampleType, Sine, Math>()
+        };
+
+        return kernels[juce::jlimit (0, (int) std::size (kernels) - 1, modelIndex)];
+    }
+
+    /** The scalar libm kernels, always available for verifying the fast paths. */
+    template <typename SampleType>
+    Kernel<SampleType> getReferenceKernel (int modelIndex) noexcept
+    {
+        static constexpr Kernel<SampleType> kernels[] =
+        {
+            &processChannel<SoftClip<ReferenceMath>, SampleType>,
+            &processChannel<HardClip<ReferenceMath>, SampleType>,
+            &processChannel<Tube<ReferenceMath>, SampleType>,
+            &processChannel<HalfWave<ReferenceMath>, SampleType>,
+            &processChannel<FullWave<ReferenceMath>, SampleType>,
+            &processChannel<Sine<ReferenceMath>, SampleType>
+        };
+
+        return kernels[juce::jlimit (0, (int) std::size (kernels) - 1, modelIndex)];
+    }
+
+    /** Returns the kernel for a model index, in the same order as the "model" parameter choices.
+        Exact always runs the scalar libm reference. High and Eco run the polynomial
+        approximations, a SIMDRegister at a time when DISTORTION_USE_SIMD is set.
+    */
+    template <typename SampleType>
+    Kernel<SampleType> getKernel (int modelIndex, Precision precision) noexcept
+    {
+        switch (precision)
+        {
+            case Precision::kExact: return getReferenceKernel<SampleType> (modelIndex);
+            case Precision::kEco:   return getApproximateKernel<SampleType, EcoMath> (modelIndex);
+            case Precision::kHigh:
+            default:                return getApproximateKernel<SampleType, HighMath> (modelIndex);
+        }
+    }
+
+    //==============================================================================
+    template <typename SampleType, typename Math>
+    RampKernel<SampleType> getApproximateRampKernel (int modelIndex) noexcept
+    {
+        static constexpr RampKernel<SampleType> kernels[] =
+        {
+            makeRampKernel<SampleType, SoftClip, Math>(),
+            makeRampKernel<SampleType, HardClip, Math>(),
+            makeRampKernel<SampleType, Tube, Math>(),
+            makeRampKernel<SampleType, HalfWave, Math>(),
+            makeRampKernel<SampleType, FullWave, Math>(),
+            makeRampKernel<SampleType, Sine, Math>()
+        };
+
+        return kernels[juce::jlimit (0, (int) std::size (kernels) - 1, modelIndex)];
+    }
+
+    template <typename SampleType>
+    RampKernel<SampleType> getReferenceRampKernel (int modelIndex) noexcept
+    {
+        static constexpr RampKernel<SampleType> kernels[] =
+        {
+            &processChannelRamp<SoftClip<ReferenceMath>, SampleType>,
+            &processChannelRamp<HardClip<ReferenceMath>, SampleType>,
+            &processChannelRamp<Tube<ReferenceMath>, SampleType>,
+            &processChannelRamp<HalfWave<ReferenceMath>, SampleType>,
+            &processChannelRamp<FullWave<ReferenceMath>, SampleType>,
+            &processChannelRamp<Sine<ReferenceMath>, SampleType>
+        };
+
+        return kernels[juce::jlimit (0, (int) std::size (kernels) - 1, modelIndex)];
+    }
+
+    /** The per-sample drive counterpart of getKernel(). */
+    template <typename SampleType>
+    RampKernel<SampleType> getRampKernel (int modelIndex, Precision precision) noexcept
+    {
+        switch (precision)
+        {
+            case Precision::kExact: return getReferenceRampKernel<SampleType> (modelIndex);
+            case Precision::kEco:   return getApproximateRampKernel<SampleType, EcoMath> (modelIndex);
+            case Precision::kHigh:
+            default:                return getApproximateRampKernel<SampleType, HighMath> (modelIndex);
+        }
+    }
+}
@@ -0,0 +1,126 @@
+/*
+  ==============================================================================
+
+    DistortionParameters.h
+
+    Plain copies of the plugin's parameters, as the DSP classes see them.
+    The processor fills one from the parameter tree at the top of each block.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "DistortionKernels.h"
+
+//==============================================================================
+// distortion models enum selection
+enum class DisModels
+{
+    kSoft,
+    kHard,
+    kTube,
+    kHalfWave,
+    kFullWave,
+    kSine
+};
+
+// shaping engine: the block kernels, the precomputed lookup table, or antiderivative anti-aliasing
+enum class Engine
+{
+    kDirect,
+    kTableLinear,
+    kTableHermite,
+    kADAA
+};
+
+// where the tone filters run. Oversampled placements only apply while the full band is oversampled
+enum class TonePlacement
+{
+    kHostRate,
+    kPostOversampled,
+    kPrePostOversampled
+};
+
+/** A shaper after the first in a serial chain, with the tilt filter in front of it. */
+struct ChainStage
+{
+    DisModels model = DisModels::kSoft;
+    float drive = 1.0f;      // linear gain
+    float tilt = 0.0f;       // dB across the spectrum, positive for brighter
+};
+
+/** What one shaping stage needs: the curve, and how to oversample it. */
+struct StageParameters
+{
+    static constexpr int maxChainStages = 4;
+
+    DisModels model = DisModels::kSoft;
+    float drive = 1.0f;      // linear gain
+    bool oversample = false;
+    int osFactorIndex = 1;   // 2x, 4x, 8x, 16x
+    int osFilterIndex = 0;   // IIR, FIR
+    DistortionKernels::Precision precision = DistortionKernels::Precision::kHigh;
+    Engine engine = Engine::kDirect;
+
+    // automatic oversampling: with oversampling on, the lowest factor up to the selected one
+    // whose predicted aliasing stays under the threshold
+    bool autoOversample = false;
+    float aliasThreshold = -90.0f;   // dBFS
+
+    // tone filters inside the oversampled pass, when they're fused
+    bool fusePreFilter = false;
+    bool fusePostFilter = false;
+    bool preFilter = false;
+    float preCutoff = 20.0f;
+    bool postFilter = false;
+    float postCutoff = 20000.0f;
+
+    // shapers after the first, all run inside the same oversampled pass
+    int numChainStages = 1;
+    std::array<ChainStage, maxChainStages - 1> chain;
+};
+
+/** Every parameter, read once at the top of each block. The audio thread works only from this copy. */
+struct DistortionParameters
+{
+    static constexpr int maxBands = 4;
+
+    bool oversample = false;
+    int osFactorIndex = 1;   // 2x, 4x, 8x, 16x
+    int osFilterIndex = 0;   // IIR, FIR
+    bool autoOversample = false;
+    float aliasThreshold = -90.0f;   // dBFS
+    bool preFilter = false;
+    float preCutoff = 20.0f;
+    DisModels model = DisModels::kSoft;
+    float drive = 1.0f;      // linear gain
+    bool postFilter = false;
+    float postCutoff = 20000.0f;
+    bool phase = false;
+    float mix = 1.0f;
+    DistortionKernels::Precision precision = DistortionKernels::Precision::kHigh;
+    Engine engine = Engine::kDirect;
+    TonePlacement tonePlacement = TonePlacement::kHostRate;
+
+    // serial chain: up to three more shapers after the first, full band only
+    int numChainStages = 1;
+    std::array<ChainStage, StageParameters::maxChainStages - 1> chain;
+
+    // multiband mode. With more than one band, each band's own model, drive, mix and
+    // oversampling switch replace the full-band ones, and the full-band mix is ignored;
+    // the factor, filter, tone filters and phase flip are shared
+    struct Band
+    {
+        DisModels model = DisModels::kSoft;
+        float drive = 1.0f;  // linear gain
+        float mix = 1.0f;
+        bool oversample = false;
+        bool bypass = false;
+    };
+
+    int numBands = 1;
+    std::array<float, maxBands - 1> crossovers {150.0f, 1000.0f, 5000.0f};
+    std::array<Band, maxBands> bands;
+};
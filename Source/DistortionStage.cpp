@@ -0,0 +1,718 @@
+/*
+  ==============================================================================
+
+    DistortionStage.cpp
+
+  ==============================================================================
+*/
+
+#include "DistortionStage.h"
+
+//==============================================================================
+template <typename SampleType>
+void DistortionStage<SampleType>::prepare (const juce::dsp::ProcessSpec& spec, const StageParameters& newParams)
+{
+    params = newParams;
+    sampleRate = spec.sampleRate;
+
+    const auto samplesPerBlock = static_cast<int>(spec.maximumBlockSize);
+
+    // build every oversampling configuration up front
+    for (int filter = 0; filter < 2; ++filter)
+    {
+        const auto filterType = filter == 0 ? juce::dsp::Oversampling<SampleType>::filterHalfBandPolyphaseIIR
+                                            : juce::dsp::Oversampling<SampleType>::filterHalfBandFIREquiripple;
+
+        for (int factor = 0; factor < numOversamplingFactors; ++factor)
+        {
+            auto& oversampler = oversamplers[static_cast<size_t>(filter * numOversamplingFactors + factor)];
+            // integer latency, so the wet path can be lined up exactly with the dry one
+            oversampler = std::make_unique<juce::dsp::Oversampling<SampleType>>(spec.numChannels, static_cast<size_t>(factor + 1), filterType, true, true);
+            oversampler->initProcessing(static_cast<size_t>(samplesPerBlock));
+        }
+    }
+
+    // automatic mode starts at the selected factor, the safe end, and works down from there
+    autoFactorIndex = params.osFactorIndex;
+    autoPendingIndex = -1;
+    autoHoldSamples = 0;
+
+    activeConfig = getTargetConfig();
+    previousConfig = activeConfig;
+    fadeLength = juce::roundToInt(0.02 * sampleRate); // 20ms
+    fadeRemaining = 0;
+    numChannels = static_cast<int>(spec.numChannels);
+    maxBlockSize = samplesPerBlock;
+
+    // padding can be as long as the slowest configuration
+    configLatency[0] = 0;
+
+    for (size_t config = 1; config < configLatency.size(); ++config)
+        configLatency[config] = static_cast<int>(std::ceil(oversamplers[config - 1]->getLatencyInSamples()));
+
+    const auto maxLatency = *std::max_element(configLatency.begin(), configLatency.end());
+
+    for (auto& padding : latencyPadding)
+    {
+        padding.setMaximumDelayInSamples(maxLatency);
+        padding.prepare(spec);
+    }
+
+    setLatency(0);
+
+    // fused tone filters run at their configuration's rate, over its up-sampled blocks, fusedChunkSize samples at a time
+    for (int config = 0; config < numOversamplingConfigs; ++config)
+    {
+        const auto factor = size_t (1) << (config % numOversamplingFactors + 1);
+        const juce::dsp::ProcessSpec oversampledSpec { sampleRate * static_cast<double>(factor),
+                                                       static_cast<juce::uint32>(juce::jmin(static_cast<size_t>(fusedChunkSize),
+                                                                                            static_cast<size_t>(samplesPerBlock) * factor)),
+                                                       spec.numChannels };
+
+        fusedPreFilters[static_cast<size_t>(config)].prepare(oversampledSpec, ToneFilter<SampleType>::Type::kHighPass,
+                                                             params.preCutoff, isFusedPreFilterOn(params));
+        fusedPostFilters[static_cast<size_t>(config)].prepare(oversampledSpec, ToneFilter<SampleType>::Type::kLowPass,
+                                                              params.postCutoff, isFusedPostFilterOn(params));
+    }
+
+    drive.reset(sampleRate, 0.05);
+    drive.setCurrentAndTargetValue(params.drive);
+
+    // chain stages. The tilt is a one-pole split at the pivot, so its coefficient depends on each configuration's rate
+    for (int index = 0; index < maxChainStages - 1; ++index)
+    {
+        const auto& settings = params.chain[static_cast<size_t>(index)];
+        chainDrive[static_cast<size_t>(index)].reset(sampleRate, 0.05);
+        chainDrive[static_cast<size_t>(index)].setCurrentAndTargetValue(settings.drive);
+        tiltTo[static_cast<size_t>(index)] = getTiltGains(settings.tilt);
+        tiltFrom[static_cast<size_t>(index)] = tiltTo[static_cast<size_t>(index)];
+    }
+
+    for (size_t config = 0; config < tiltCoefficient.size(); ++config)
+    {
+        const auto rate = config == 0 ? sampleRate : sampleRate * static_cast<double>(1 << ((config - 1) % numOversamplingFactors + 1));
+        const auto g = std::tan(juce::MathConstants<double>::pi * tiltPivot / rate);
+        tiltCoefficient[config] = static_cast<SampleType>(g / (1.0 + g));
+    }
+
+    for (auto& states : tiltStates)
+        states.assign(spec.numChannels, {});
+
+    for (auto& states : adaaStates)
+        states.assign(spec.numChannels, {});
+
+    autoLastSamples.assign(spec.numChannels, SampleType(0));
+    previousEngine = params.engine;
+
+    silentSamples = 0;
+    idle = false;
+}
+
+template <typename SampleType>
+void DistortionStage<SampleType>::allocateScratch (ScratchArena& arena, juce::dsp::AudioBlock<SampleType> filterScratch)
+{
+    fadeScratch = arena.allocateBlock<SampleType>(static_cast<size_t>(numChannels), static_cast<size_t>(maxBlockSize));
+
+    // the drive ramp may need to cover the largest oversampled block
+    driveRamp = arena.allocateArray<SampleType>(static_cast<size_t>(maxBlockSize));
+    oversampledDriveRamp = arena.allocateArray<SampleType>(static_cast<size_t>(maxBlockSize * maxOversamplingFactor));
+    chainRamps = arena.allocateArray<SampleType>(static_cast<size_t>(maxBlockSize * (maxChainStages - 1)));
+    oversampledChainRamps = arena.allocateArray<SampleType>(static_cast<size_t>(maxBlockSize * maxOversamplingFactor * (maxChainStages - 1)));
+
+    for (auto* filters : { &fusedPreFilters, &fusedPostFilters })
+        for (auto& filter : *filters)
+            filter.setFadeScratch(filterScratch);
+}
+
+//==============================================================================
+template <typename SampleType>
+void DistortionStage<SampleType>::process (juce::dsp::AudioBlock<SampleType>& block, const StageParameters& newParams)
+{
+    params = newParams;
+    drive.setTargetValue(params.drive);
+
+    for (int index = 0; index < maxChainStages - 1; ++index)
+    {
+        const auto& settings = params.chain[static_cast<size_t>(index)];
+        chainDrive[static_cast<size_t>(index)].setTargetValue(settings.drive);
+        tiltFrom[static_cast<size_t>(index)] = tiltTo[static_cast<size_t>(index)];
+        tiltTo[static_cast<size_t>(index)] = getTiltGains(settings.tilt);
+    }
+
+    const auto numSamples = static_cast<int>(block.getNumSamples());
+    hostBlockSize = numSamples;
+
+    // a stage with nothing coming in, such as an empty band, costs a scan of its input
+    if (isSilent(block))
+    {
+        const auto wasDecayed = silentSamples >= getTailSamples();
+        silentSamples = juce::jmin(silentSamples + numSamples, std::numeric_limits<int>::max() / 2);
+
+        if (wasDecayed)
+        {
+            block.clear();
+            skip(params);
+            idle = true;
+            return;
+        }
+    }
+    else
+    {
+        silentSamples = 0;
+
+        if (idle)
+        {
+            reset();
+            idle = false;
+        }
+    }
+
+    // drive ramp, worked out once for every channel and oversampling configuration
+    driveRamping = drive.isSmoothing();
+
+    if (driveRamping)
+    {
+        for (int sample = 0; sample < numSamples; ++sample)
+            driveRamp[sample] = drive.getNextValue();
+    }
+
+    for (int index = 0; index < params.numChainStages - 1; ++index)
+    {
+        auto& chainStageDrive = chainDrive[static_cast<size_t>(index)];
+        chainRamping[static_cast<size_t>(index)] = chainStageDrive.isSmoothing();
+
+        if (chainStageDrive.isSmoothing())
+        {
+            auto* ramp = chainRamps + index * maxBlockSize;
+
+            for (int sample = 0; sample < numSamples; ++sample)
+                ramp[sample] = chainStageDrive.getNextValue();
+        }
+    }
+
+    // ADAA history from an earlier stint would be stale, so switching to it starts from silence
+    if (params.engine == Engine::kADAA && previousEngine != Engine::kADAA)
+    {
+        for (auto& states : adaaStates)
+            std::fill(states.begin(), states.end(), ADAAKernels::ChannelState{});
+    }
+
+    previousEngine = params.engine;
+
+    // oversampling choice. A change crossfades from the old configuration. A fade that's running holds back
+    // any other change except a step up, so the automatic mode never aliases for the length of a fade
+    updateAutoFactor(block);
+    const auto targetConfig = getTargetConfig();
+
+    if (targetConfig != activeConfig)
+    {
+        if (fadeRemaining == 0)
+        {
+            startFade(activeConfig, targetConfig);
+        }
+        else if (getFactorIndex(targetConfig) > getFactorIndex(activeConfig))
+        {
+            const auto gain = getFadeGain(0);
+
+            if (targetConfig == previousConfig)
+            {
+                // back to the outgoing configuration, which is still running: turn the fade round where it is
+                std::swap(previousConfig, activeConfig);
+                fadeRemaining = juce::roundToInt(static_cast<double>(gain) * fadeLength);
+            }
+            else
+            {
+                // cut the fade short from whichever side is louder. Both are the same signal at the same latency,
+                // so the jump is only between two oversampled versions of it
+                startFade(gain < SampleType(0.5) ? previousConfig : activeConfig, targetConfig);
+            }
+        }
+    }
+
+    for (auto config : { activeConfig, previousConfig })
+    {
+        if (config > 0)
+        {
+            fusedPreFilters[static_cast<size_t>(config - 1)].setTarget(params.preCutoff, isFusedPreFilterOn(params));
+            fusedPostFilters[static_cast<size_t>(config - 1)].setTarget(params.postCutoff, isFusedPostFilterOn(params));
+        }
+    }
+
+    if (fadeRemaining > 0)
+    {
+        auto fadeBlock = fadeScratch.getSubsetChannelBlock(0, block.getNumChannels()).getSubBlock(0, block.getNumSamples());
+        fadeBlock.copyFrom(block);
+
+        processConfig(fadeBlock, previousConfig);
+        processConfig(block, activeConfig);
+
+        // linear fade from the old configuration to the new one
+        for (size_t ch = 0; ch < block.getNumChannels(); ++ch)
+        {
+            SampleType* data = block.getChannelPointer(ch);
+            const SampleType* faded = fadeBlock.getChannelPointer(ch);
+
+            for (int sample = 0; sample < numSamples; ++sample)
+            {
+                const auto gain = getFadeGain(sample);
+                data[sample] = faded[sample] + gain * (data[sample] - faded[sample]);
+            }
+        }
+
+        fadeRemaining = juce::jmax(0, fadeRemaining - numSamples);
+    }
+    else
+    {
+        processConfig(block, activeConfig);
+    }
+}
+
+template <typename SampleType>
+int DistortionStage<SampleType>::getTailSamples() const noexcept
+{
+    // the oversampling filters settle inside the margin. The fused tone filters and the chain's tilt filters
+    // run one after the other, so their ring times add up
+    constexpr double margin = 0.005;
+    auto ring = margin;
+
+    if (isFusedPreFilterOn(params))
+        ring += ToneFilter<SampleType>::getRingSeconds(params.preCutoff);
+
+    if (isFusedPostFilterOn(params))
+        ring += ToneFilter<SampleType>::getRingSeconds(params.postCutoff);
+
+    // a one-pole is down 120 dB after 13.8 time constants
+    for (int index = 0; index < params.numChainStages - 1; ++index)
+        if (params.chain[static_cast<size_t>(index)].tilt != 0.0f)
+            ring += 13.8 / (juce::MathConstants<double>::twoPi * tiltPivot);
+
+    return latency + static_cast<int>(std::ceil(ring * sampleRate));
+}
+
+template <typename SampleType>
+void DistortionStage<SampleType>::skip (const StageParameters& newParams) noexcept
+{
+    // nothing can be heard moving, so the drive jumps to its target and a pending oversampling switch needs no fade
+    params = newParams;
+    drive.setCurrentAndTargetValue(params.drive);
+
+    for (int index = 0; index < maxChainStages - 1; ++index)
+    {
+        const auto& settings = params.chain[static_cast<size_t>(index)];
+        chainDrive[static_cast<size_t>(index)].setCurrentAndTargetValue(settings.drive);
+        tiltTo[static_cast<size_t>(index)] = getTiltGains(settings.tilt);
+        tiltFrom[static_cast<size_t>(index)] = tiltTo[static_cast<size_t>(index)];
+    }
+
+    activeConfig = getTargetConfig();
+    previousConfig = activeConfig;
+    fadeRemaining = 0;
+    previousEngine = params.engine;
+    std::fill(autoLastSamples.begin(), autoLastSamples.end(), SampleType(0));
+
+    if (activeConfig > 0)
+        restartFusedFilters(activeConfig);
+}
+
+template <typename SampleType>
+void DistortionStage<SampleType>::reset() noexcept
+{
+    // only the active configuration has run recently
+    if (activeConfig > 0)
+    {
+        oversamplers[static_cast<size_t>(activeConfig - 1)]->reset();
+        fusedPreFilters[static_cast<size_t>(activeConfig - 1)].reset();
+        fusedPostFilters[static_cast<size_t>(activeConfig - 1)].reset();
+    }
+
+    latencyPadding[static_cast<size_t>(activeConfig)].reset();
+
+    auto& states = adaaStates[static_cast<size_t>(activeConfig)];
+    std::fill(states.begin(), states.end(), ADAAKernels::ChannelState{});
+    clearTiltState(activeConfig);
+    std::fill(autoLastSamples.begin(), autoLastSamples.end(), SampleType(0));
+}
+
+template <typename SampleType>
+void DistortionStage<SampleType>::setLatency (int latencySamples)
+{
+    latency = latencySamples;
+
+    for (size_t config = 0; config < latencyPadding.size(); ++config)
+        latencyPadding[config].setDelay(static_cast<SampleType>(juce::jmax(0, latency - configLatency[config])));
+}
+
+template <typename SampleType>
+int DistortionStage<SampleType>::getOversamplingLatency (int factorIndex, int filterIndex) const noexcept
+{
+    return configLatency[static_cast<size_t>(1 + filterIndex * numOversamplingFactors + factorIndex)];
+}
+
+template <typename SampleType>
+bool DistortionStage<SampleType>::isSilent (const juce::dsp::AudioBlock<SampleType>& block) noexcept
+{
+    for (size_t ch = 0; ch < block.getNumChannels(); ++ch)
+    {
+        const auto range = juce::FloatVectorOperations::findMinAndMax(block.getChannelPointer(ch), static_cast<int>(block.getNumSamples()));
+
+        if (juce::jmax(-range.getStart(), range.getEnd()) >= silenceThreshold)
+            return false;
+    }
+
+    return true;
+}
+
+template <typename SampleType>
+SampleType DistortionStage<SampleType>::getPeak (const juce::dsp::AudioBlock<SampleType>& block) noexcept
+{
+    SampleType peak = 0;
+
+    for (size_t ch = 0; ch < block.getNumChannels(); ++ch)
+    {
+        const auto range = juce::FloatVectorOperations::findMinAndMax(block.getChannelPointer(ch), static_cast<int>(block.getNumSamples()));
+        peak = juce::jmax(peak, -range.getStart(), range.getEnd());
+    }
+
+    return peak;
+}
+
+//==============================================================================
+template <typename SampleType>
+void DistortionStage<SampleType>::restartFusedFilters (int config) noexcept
+{
+    // a configuration that has been sitting idle picks up the current settings straight away, from clean state
+    auto& preFilter = fusedPreFilters[static_cast<size_t>(config - 1)];
+    auto& postFilter = fusedPostFilters[static_cast<size_t>(config - 1)];
+
+    preFilter.setTarget(params.preCutoff, isFusedPreFilterOn(params));
+    preFilter.skip();
+    preFilter.reset();
+    postFilter.setTarget(params.postCutoff, isFusedPostFilterOn(params));
+    postFilter.skip();
+    postFilter.reset();
+}
+
+template <typename SampleType>
+void DistortionStage<SampleType>::startFade (int fromConfig, int toConfig) noexcept
+{
+    previousConfig = fromConfig;
+    activeConfig = toConfig;
+
+    // the incoming path starts from silence, so it puts out nothing until its latency has passed.
+    // The fade waits that long before it moves, so both sides carry signal while the gains change
+    fadeRemaining = latency + fadeLength;
+
+    // the incoming oversampler has been idle, so start it from silence rather than stale state
+    if (activeConfig > 0)
+    {
+        oversamplers[static_cast<size_t>(activeConfig - 1)]->reset();
+        restartFusedFilters(activeConfig);
+    }
+
+    latencyPadding[static_cast<size_t>(activeConfig)].reset();
+    clearTiltState(activeConfig);
+}
+
+template <typename SampleType>
+SampleType DistortionStage<SampleType>::getFadeGain (int sample) const noexcept
+{
+    // negative positions are the wait for the incoming path's latency
+    const auto position = fadeLength - fadeRemaining + sample + 1;
+    return juce::jlimit(SampleType(0), SampleType(1), static_cast<SampleType>(position) / static_cast<SampleType>(fadeLength));
+}
+
+template <typename SampleType>
+int DistortionStage<SampleType>::getTargetConfig() const noexcept
+{
+    if (! params.oversample)
+        return 0;
+
+    const auto factorIndex = params.autoOversample ? autoFactorIndex : params.osFactorIndex;
+
+    if (factorIndex < 0)
+        return 0;
+
+    return 1 + params.osFilterIndex * numOversamplingFactors + factorIndex;
+}
+
+template <typename SampleType>
+void DistortionStage<SampleType>::updateAutoFactor (const juce::dsp::AudioBlock<SampleType>& block) noexcept
+{
+    if (! params.oversample || ! params.autoOversample)
+    {
+        autoFactorIndex = params.osFactorIndex;
+        autoPendingIndex = -1;
+        autoHoldSamples = 0;
+        std::fill(autoLastSamples.begin(), autoLastSamples.end(), SampleType(0));
+        return;
+    }
+
+    // the lowest factor that keeps the block under the threshold, or the selected one if none does
+    const auto input = AliasingEstimate::measure(block, autoLastSamples.data());
+    auto neededIndex = params.osFactorIndex;
+
+    for (int index = -1; index < params.osFactorIndex; ++index)
+    {
+        if (getPredictedAliasing(input, 1 << (index + 1)) < params.aliasThreshold)
+        {
+            neededIndex = index;
+            break;
+        }
+    }
+
+    // a lower selected factor caps the current one straight away
+    autoFactorIndex = juce::jmin(autoFactorIndex, params.osFactorIndex);
+
+    if (neededIndex >= autoFactorIndex)
+    {
+        autoFactorIndex = neededIndex;
+        autoPendingIndex = -1;
+        autoHoldSamples = 0;
+        return;
+    }
+
+    autoPendingIndex = juce::jmax(autoPendingIndex, neededIndex);
+    autoHoldSamples += static_cast<int>(block.getNumSamples());
+
+    if (autoHoldSamples >= juce::roundToInt(autoHoldTime * sampleRate))
+    {
+        autoFactorIndex = autoPendingIndex;
+        autoPendingIndex = -1;
+        autoHoldSamples = 0;
+    }
+}
+
+template <typename SampleType>
+double DistortionStage<SampleType>::getPredictedAliasing (const AliasingEstimate::InputMeasure& input, int factor) const noexcept
+{
+    // the loudest of the chain's shapers, each taken as if it saw the input level
+    auto level = AliasingEstimate::predict(params.model, drive.getTargetValue(), input, factor);
+
+    for (int index = 0; index < params.numChainStages - 1; ++index)
+    {
+        const auto& settings = params.chain[static_cast<size_t>(index)];
+        level = juce::jmax(level, AliasingEstimate::predict(settings.model, settings.drive, input, factor));
+    }
+
+    return level;
+}
+
+template <typename SampleType>
+void DistortionStage<SampleType>::processConfig (juce::dsp::AudioBlock<SampleType>& block, int config)
+{
+    // oversampling off
+    if (config == 0)
+    {
+        const auto start = readClock();
+        applyDistortion(block, config);
+        timings.shapeTicks += readClock() - start;
+    }
+    else
+    {
+        auto& oversampler = *oversamplers[static_cast<size_t>(config - 1)];
+
+        // increase sample rate
+        const auto start = readClock();
+        auto upSampledBlock = oversampler.processSamplesUp(block);
+        const auto upsampled = readClock();
+
+        applyDistortion(upSampledBlock, config);
+        const auto shaped = readClock();
+
+        //decrease sample rate
+        oversampler.processSamplesDown(block);
+
+        timings.upsampleTicks += upsampled - start;
+        timings.shapeTicks += shaped - upsampled;
+        timings.downsampleTicks += readClock() - shaped;
+    }
+
+    // pad up to the stage's latency
+    if (latency > configLatency[static_cast<size_t>(config)])
+        latencyPadding[static_cast<size_t>(config)].process(juce::dsp::ProcessContextReplacing<SampleType>(block));
+}
+
+template <typename SampleType>
+void DistortionStage<SampleType>::applyDistortion (juce::dsp::AudioBlock<SampleType>& block, int config)
+{
+    const auto numSamples = static_cast<int>(block.getNumSamples());
+
+    // per-sample drives while they're ramping
+    const SampleType* ramp = driveRamping ? expandRamp(driveRamp, oversampledDriveRamp, numSamples) : nullptr;
+    std::array<const SampleType*, maxChainStages - 1> chainRamp {};
+
+    for (int index = 0; index < params.numChainStages - 1; ++index)
+    {
+        if (chainRamping[static_cast<size_t>(index)])
+            chainRamp[static_cast<size_t>(index)] = expandRamp(chainRamps + index * maxBlockSize,
+                                                               oversampledChainRamps + index * maxBlockSize * maxOversamplingFactor,
+                                                               numSamples);
+    }
+
+    const auto fused = config > 0 && (fusedPreFilters[static_cast<size_t>(config - 1)].isActive()
+                                      || fusedPostFilters[static_cast<size_t>(config - 1)].isActive());
+
+    if (! fused && params.numChainStages <= 1)
+    {
+        shape(block, config, ramp);
+        return;
+    }
+
+    // tone filters and chain stages in the same pass. Each chunk goes through all of them while it's still in cache
+    for (int start = 0; start < numSamples; start += fusedChunkSize)
+    {
+        const auto length = juce::jmin(fusedChunkSize, numSamples - start);
+        auto chunk = block.getSubBlock(static_cast<size_t>(start), static_cast<size_t>(length));
+
+        if (fused)
+            fusedPreFilters[static_cast<size_t>(config - 1)].process(chunk);
+
+        shape(chunk, config, ramp != nullptr ? ramp + start : nullptr);
+
+        for (int index = 0; index < params.numChainStages - 1; ++index)
+        {
+            const auto* stageRamp = chainRamp[static_cast<size_t>(index)];
+            shapeChainStage(chunk, config, index, stageRamp != nullptr ? stageRamp + start : nullptr, start, numSamples);
+        }
+
+        if (fused)
+            fusedPostFilters[static_cast<size_t>(config - 1)].process(chunk);
+    }
+}
+
+template <typename SampleType>
+const SampleType* DistortionStage<SampleType>::expandRamp (const SampleType* hostRamp, SampleType* oversampledRamp, int numSamples) const noexcept
+{
+    const auto factor = numSamples / juce::jmax(1, hostBlockSize);
+
+    if (factor <= 1)
+        return hostRamp;
+
+    for (int sample = 0; sample < numSamples; ++sample)
+        oversampledRamp[sample] = hostRamp[sample / factor];
+
+    return oversampledRamp;
+}
+
+template <typename SampleType>
+void DistortionStage<SampleType>::shape (juce::dsp::AudioBlock<SampleType>& block, int config, const SampleType* ramp)
+{
+    const auto numSamples = static_cast<int>(block.getNumSamples());
+    const auto model = static_cast<int>(params.model);
+
+    // ADAA, for the models that have an antiderivative. Tube falls through to the kernels
+    if (params.engine == Engine::kADAA)
+    {
+        if (const auto adaaKernel = ADAAKernels::getKernel<SampleType>(model))
+        {
+            auto& states = adaaStates[static_cast<size_t>(config)];
+
+            for (size_t ch = 0; ch < block.getNumChannels(); ++ch)
+                adaaKernel(block.getChannelPointer(ch), numSamples, ramp, drive.getTargetValue(), states[ch]);
+
+            return;
+        }
+    }
+
+    // the table is built for one drive, so ramps always go through the kernels
+    if (ramp != nullptr)
+    {
+        const auto rampKernel = DistortionKernels::getRampKernel<SampleType>(model, params.precision);
+
+        for (size_t ch = 0; ch < block.getNumChannels(); ++ch)
+            rampKernel(block.getChannelPointer(ch), ramp, numSamples);
+
+        return;
+    }
+
+    // distortion choice, made once per block. The table engine falls back to the kernels until there is a table
+    // for the current model and drive, so a change is never heard through the old curve
+    const auto kernel = DistortionKernels::getKernel<SampleType>(model, params.precision);
+    const bool useTable = (params.engine == Engine::kTableLinear || params.engine == Engine::kTableHermite)
+                            && waveshaperTable != nullptr && waveshaperTable->acquireLatest(model, params.drive);
+    const auto interpolation = params.engine == Engine::kTableLinear ? WaveshaperTable::Interpolation::kLinear
+                                                                     : WaveshaperTable::Interpolation::kHermite;
+
+    for (size_t ch = 0; ch < block.getNumChannels(); ++ch)
+    {
+        SampleType* data = block.getChannelPointer(ch);
+
+        if (useTable)
+            waveshaperTable->process(data, numSamples, interpolation);
+        else
+            kernel(data, numSamples, drive.getTargetValue());
+    }
+}
+
+template <typename SampleType>
+void DistortionStage<SampleType>::shapeChainStage (juce::dsp::AudioBlock<SampleType>& block, int config, int index,
+                                                   const SampleType* ramp, int start, int length)
+{
+    const auto numSamples = static_cast<int>(block.getNumSamples());
+    const auto& settings = params.chain[static_cast<size_t>(index)];
+    const auto& from = tiltFrom[static_cast<size_t>(index)];
+    const auto& to = tiltTo[static_cast<size_t>(index)];
+    const auto coefficient = tiltCoefficient[static_cast<size_t>(config)];
+    auto& states = tiltStates[static_cast<size_t>(config)];
+
+    // tilt: the low and high halves of a one-pole split, each with its own gain
+    const auto tilting = from.low != 1 || from.high != 1 || to.low != 1 || to.high != 1;
+
+    for (size_t ch = 0; tilting && ch < block.getNumChannels(); ++ch)
+    {
+        SampleType* data = block.getChannelPointer(ch);
+        auto state = states[ch][static_cast<size_t>(index)];
+
+        for (int sample = 0; sample < numSamples; ++sample)
+        {
+            const auto position = static_cast<SampleType>(start + sample + 1) / static_cast<SampleType>(length);
+            const auto low = from.low + position * (to.low - from.low);
+            const auto high = from.high + position * (to.high - from.high);
+
+            const auto v = (data[sample] - state) * coefficient;
+            const auto lowPassed = v + state;
+            state = lowPassed + v;
+
+            data[sample] = low * lowPassed + high * (data[sample] - lowPassed);
+        }
+
+        states[ch][static_cast<size_t>(index)] = state;
+    }
+
+    // shaper. The table and ADAA only cover the first stage, so the rest use the kernels at the stage's precision
+    const auto model = static_cast<int>(settings.model);
+
+    if (ramp != nullptr)
+    {
+        const auto rampKernel = DistortionKernels::getRampKernel<SampleType>(model, params.precision);
+
+        for (size_t ch = 0; ch < block.getNumChannels(); ++ch)
+            rampKernel(block.getChannelPointer(ch), ramp, numSamples);
+
+        return;
+    }
+
+    const auto kernel = DistortionKernels::getKernel<SampleType>(model, params.precision);
+
+    for (size_t ch = 0; ch < block.getNumChannels(); ++ch)
+        kernel(block.getChannelPointer(ch), numSamples, chainDrive[static_cast<size_t>(index)].getTargetValue());
+}
+
+template <typename SampleType>
+typename DistortionStage<SampleType>::TiltGains DistortionStage<SampleType>::getTiltGains (float tilt) noexcept
+{
+    // half the tilt cuts the lows and half lifts the highs, so the pivot stays where it is
+    const auto high = juce::Decibels::decibelsToGain(static_cast<SampleType>(tilt) / 2);
+    return { 1 / high, high };
+}
+
+template <typename SampleType>
+void DistortionStage<SampleType>::clearTiltState (int config) noexcept
+{
+    auto& states = tiltStates[static_cast<size_t>(config)];
+    std::fill(states.begin(), states.end(), std::array<SampleType, maxChainStages - 1> {});
+}
+
+//==============================================================================
+template class DistortionStage<float>;
+template class DistortionStage<double>;
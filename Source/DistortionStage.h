@@ -0,0 +1,218 @@
+/*
+  ==============================================================================
+
+    DistortionStage.h
+
+    One shaping stage: oversampling, the shaper itself and the latency
+    padding, with its own drive smoothing. Whatever configuration it runs in,
+    its output is its input delayed by the latency given to setLatency(), so
+    stages can be summed or mixed with a delayed dry signal. The engine runs
+    one for the full band, or one for each band in multiband mode.
+
+    Up to three more shapers can follow the first in a serial chain, each
+    behind its own tilt filter. They all run inside the same up-sampled
+    block, so the chain pays for one up/down conversion and one oversampling
+    latency however many shapers it has.
+
+    In automatic mode the stage picks its own factor each block: the lowest,
+    up to the selected one, whose predicted aliasing for the block stays
+    under the threshold. It steps up straight away and only steps down once
+    the lower factor has been enough for autoHoldTime. Every factor is
+    padded to the same latency and a change crossfades like any other
+    switch, so the host never notices.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "DistortionParameters.h"
+#include "DistortionKernels.h"
+#include "WaveshaperTable.h"
+#include "ADAAKernels.h"
+#include "ToneFilter.h"
+#include "Instrumentation.h"
+#include "ScratchArena.h"
+#include "AliasingEstimate.h"
+
+//==============================================================================
+/**
+*/
+template <typename SampleType>
+class DistortionStage
+{
+public:
+    DistortionStage() = default;
+
+    /** The table is only read when the stage's engine parameter asks for it, so it can stay null. */
+    void setWaveshaperTable (WaveshaperTable* tableToUse) noexcept    { waveshaperTable = tableToUse; }
+
+    /** Allocates everything for this spec and starts from the given parameters without ramping. */
+    void prepare (const juce::dsp::ProcessSpec& spec, const StageParameters& params);
+
+    /** Takes the stage's working buffers from the arena, after prepare(). The fused tone filters share
+        filterScratch, which must hold at least fusedChunkSize samples of every channel.
+    */
+    void allocateScratch (ScratchArena& arena, juce::dsp::AudioBlock<SampleType> filterScratch);
+
+    /** Shapes a block in place, ramping the drive and crossfading a change of configuration.
+        A block that follows a long enough run of silence is cleared without being processed.
+    */
+    void process (juce::dsp::AudioBlock<SampleType>& block, const StageParameters& params);
+
+    /** Jumps straight to the parameters' targets, for blocks that aren't processed at all. */
+    void skip (const StageParameters& params) noexcept;
+
+    /** Clears the oversampler, padding and ADAA history of the running configuration. */
+    void reset() noexcept;
+
+    /** Pads every configuration up to this latency, so all of them line up. */
+    void setLatency (int latencySamples);
+
+    /** Latency of the oversampled configuration with this factor and filter. */
+    int getOversamplingLatency (int factorIndex, int filterIndex) const noexcept;
+
+    /** Time spent up-sampling, shaping and down-sampling, for instrumentation. Only counted while measuring. */
+    struct Timings
+    {
+        juce::int64 upsampleTicks = 0;
+        juce::int64 shapeTicks = 0;
+        juce::int64 downsampleTicks = 0;
+    };
+
+    void setMeasuring (bool shouldMeasure) noexcept    { measuring = shouldMeasure; }
+
+    /** Returns the time counted since the last call, and starts counting again from zero. */
+    Timings takeTimings() noexcept                     { return std::exchange(timings, {}); }
+
+    /** True if every sample of the block is below silenceThreshold. Stops at the first channel that isn't. */
+    static bool isSilent (const juce::dsp::AudioBlock<SampleType>& block) noexcept;
+
+    /** Largest magnitude in the block, across all channels. */
+    static SampleType getPeak (const juce::dsp::AudioBlock<SampleType>& block) noexcept;
+
+    // below about -160 dB, which stays inaudible even after the largest drive gain
+    static constexpr SampleType silenceThreshold = SampleType (1.0e-8);
+
+    static constexpr int numOversamplingFactors = 4;
+    static constexpr int numOversamplingConfigs = numOversamplingFactors * 2;
+    static constexpr int maxOversamplingFactor = 1 << numOversamplingFactors;
+
+    // the fused tone filters go over the up-sampled block this many samples at a time
+    static constexpr int fusedChunkSize = 256;
+
+private:
+    //==============================================================================
+    // config 0 is native rate, 1 + filter * numOversamplingFactors + factor is one of the oversamplers
+    int getTargetConfig() const noexcept;
+    static int getFactorIndex (int config) noexcept    { return config == 0 ? -1 : (config - 1) % numOversamplingFactors; }
+
+    // crossfades from one configuration to another, and the incoming side's gain at a sample of this block
+    void startFade (int fromConfig, int toConfig) noexcept;
+    SampleType getFadeGain (int sample) const noexcept;
+
+    // automatic oversampling: the factor index for this block from the aliasing prediction, -1 for none
+    void updateAutoFactor (const juce::dsp::AudioBlock<SampleType>& block) noexcept;
+    double getPredictedAliasing (const AliasingEstimate::InputMeasure& input, int factor) const noexcept;
+    void processConfig (juce::dsp::AudioBlock<SampleType>& block, int config);
+
+    // shapes every channel of the block with the current model, at the rate of the given oversampling config,
+    // with the fused tone filters around it when they're on
+    void applyDistortion (juce::dsp::AudioBlock<SampleType>& block, int config);
+    void shape (juce::dsp::AudioBlock<SampleType>& block, int config, const SampleType* ramp);
+
+    // one of the chain stages after the first: its tilt filter, then its shaper, always through the kernels.
+    // start and length place the block within the config's whole block, for the tilt gain ramp
+    void shapeChainStage (juce::dsp::AudioBlock<SampleType>& block, int config, int index, const SampleType* ramp, int start, int length);
+
+    // the host-rate ramp held across the oversampled samples each value covers, or the ramp itself at factor 1
+    const SampleType* expandRamp (const SampleType* hostRamp, SampleType* oversampledRamp, int numSamples) const noexcept;
+
+    // the engine's tone filters, moved inside the oversampled pass
+    static bool isFusedPreFilterOn (const StageParameters& p) noexcept     { return p.preFilter && p.fusePreFilter; }
+    static bool isFusedPostFilterOn (const StageParameters& p) noexcept    { return p.postFilter && p.fusePostFilter; }
+    void restartFusedFilters (int config) noexcept;
+
+    juce::int64 readClock() const noexcept    { return measuring ? juce::Time::getHighResolutionTicks() : 0; }
+
+    //==============================================================================
+    WaveshaperTable* waveshaperTable = nullptr;
+    StageParameters params;
+
+    // every oversampling configuration is built in prepare, so switching never allocates on the audio thread
+    std::array<std::unique_ptr<juce::dsp::Oversampling<SampleType>>, numOversamplingConfigs> oversamplers;
+    int activeConfig {0};
+    int previousConfig {0};
+
+    // crossfade from the previous configuration after a switch, so changing oversampling doesn't click.
+    // fadeRemaining counts the wait for the incoming latency as well as the fade itself
+    juce::dsp::AudioBlock<SampleType> fadeScratch;
+    int fadeLength {0};
+    int fadeRemaining {0};
+
+    // latency of each configuration, and the padding that brings each one up to the stage's latency
+    std::array<int, numOversamplingConfigs + 1> configLatency {};
+    std::array<juce::dsp::DelayLine<SampleType, juce::dsp::DelayLineInterpolationTypes::None>, numOversamplingConfigs + 1> latencyPadding;
+    int latency {0};
+
+    // input silence. After the tail (latency, the fused filters' ring and a margin), the output is silent too
+    int getTailSamples() const noexcept;
+    double sampleRate {0.0};
+    int silentSamples {0};
+    bool idle {false};
+
+    juce::SmoothedValue<SampleType> drive {1};
+
+    bool measuring {false};
+    Timings timings;
+
+    // tone filters for each oversampled configuration, used instead of the engine's when they're fused.
+    // They only ever run on the configuration's up-sampled blocks, fusedChunkSize samples at a time
+    std::array<ToneFilter<SampleType>, numOversamplingConfigs> fusedPreFilters, fusedPostFilters;
+
+    // automatic oversampling. A lower factor has to be enough for autoHoldTime before the stage steps down to it,
+    // and autoPendingIndex is the highest one needed while waiting
+    static constexpr double autoHoldTime = 0.25;
+    int autoFactorIndex {0};
+    int autoPendingIndex {-1};
+    int autoHoldSamples {0};
+    std::vector<SampleType> autoLastSamples;   // each channel's last input sample, for the first difference of the next block
+
+    // serial chain. Each stage after the first has its own drive and a first-order tilt around tiltPivot in front of it.
+    // The tilt's low and high gains are ramped from the last block's values across each block
+    static constexpr int maxChainStages = StageParameters::maxChainStages;
+    static constexpr double tiltPivot = 800.0;
+
+    struct TiltGains
+    {
+        SampleType low = 1;
+        SampleType high = 1;
+    };
+
+    std::array<juce::SmoothedValue<SampleType>, maxChainStages - 1> chainDrive;
+    std::array<bool, maxChainStages - 1> chainRamping {};
+    std::array<TiltGains, maxChainStages - 1> tiltFrom, tiltTo;
+    std::array<SampleType, numOversamplingConfigs + 1> tiltCoefficient {};
+    std::array<std::vector<std::array<SampleType, maxChainStages - 1>>, numOversamplingConfigs + 1> tiltStates;
+    SampleType* chainRamps = nullptr;
+    SampleType* oversampledChainRamps = nullptr;
+
+    static TiltGains getTiltGains (float tilt) noexcept;
+    void clearTiltState (int config) noexcept;
+
+    // ADAA history for every channel of every configuration, since each runs at its own rate
+    std::array<std::vector<ADAAKernels::ChannelState>, numOversamplingConfigs + 1> adaaStates;
+    Engine previousEngine {Engine::kDirect};
+
+    // per-sample drive, computed once per block and shared by all channels. Both point into the engine's arena
+    SampleType* driveRamp = nullptr;
+    SampleType* oversampledDriveRamp = nullptr;
+    bool driveRamping {false};
+    int hostBlockSize {0};
+    int maxBlockSize {0};
+    int numChannels {0};
+
+    //==============================================================================
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DistortionStage)
+};
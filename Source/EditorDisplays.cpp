@@ -0,0 +1,146 @@
+/*
+  ==============================================================================
+
+    EditorDisplays.cpp
+
+  ==============================================================================
+*/
+
+#include "EditorDisplays.h"
+#include "DistortionKernels.h"
+
+namespace
+{
+    const auto backgroundColour = juce::Colour(0xff1b1d21);
+    const auto gridColour = juce::Colour(0xff3a3e45);
+    const auto traceColour = juce::Colour(0xffe8a33d);
+
+    // -1 to 1 inside the bounds, with a little room above and below for curves that overshoot
+    constexpr float verticalRange = 1.2f;
+
+    void drawGrid (juce::Graphics& g, juce::Rectangle<float> bounds)
+    {
+        g.setColour(gridColour);
+        g.drawHorizontalLine(juce::roundToInt(bounds.getCentreY()), bounds.getX(), bounds.getRight());
+        g.drawVerticalLine(juce::roundToInt(bounds.getCentreX()), bounds.getY(), bounds.getBottom());
+        g.drawRect(bounds);
+    }
+
+    float toY (juce::Rectangle<float> bounds, float value) noexcept
+    {
+        const auto clipped = juce::jlimit(-verticalRange, verticalRange, value);
+        return bounds.getCentreY() - clipped / verticalRange * bounds.getHeight() * 0.5f;
+    }
+}
+
+//==============================================================================
+TransferCurveDisplay::TransferCurveDisplay()
+{
+    setOpaque(true);
+    values.resize(numPoints);
+}
+
+void TransferCurveDisplay::setCurve (const Shaper* newShapers, int numNewShapers)
+{
+    numNewShapers = juce::jlimit(0, maxShapers, numNewShapers);
+
+    if (numNewShapers == numShapers && std::equal(newShapers, newShapers + numNewShapers, shapers.begin()))
+        return;
+
+    std::copy_n(newShapers, numNewShapers, shapers.begin());
+    numShapers = numNewShapers;
+
+    // the reference kernels, so the curve is the exact one whatever precision or engine the audio runs at
+    for (int point = 0; point < numPoints; ++point)
+        values[static_cast<size_t>(point)] = juce::jmap(static_cast<float>(point), 0.0f, static_cast<float>(numPoints - 1), -1.0f, 1.0f);
+
+    for (int index = 0; index < numShapers; ++index)
+    {
+        const auto& shaper = shapers[static_cast<size_t>(index)];
+        DistortionKernels::getReferenceKernel<float>(shaper.model)(values.data(), numPoints, shaper.drive);
+    }
+
+    updatePath();
+    repaint();
+}
+
+void TransferCurveDisplay::paint (juce::Graphics& g)
+{
+    g.fillAll(backgroundColour);
+    drawGrid(g, getLocalBounds().toFloat());
+
+    g.setColour(traceColour);
+    g.strokePath(path, juce::PathStrokeType(2.0f));
+}
+
+void TransferCurveDisplay::resized()
+{
+    updatePath();
+}
+
+void TransferCurveDisplay::updatePath()
+{
+    path.clear();
+
+    if (numShapers == 0)
+        return;
+
+    const auto bounds = getLocalBounds().toFloat();
+
+    for (int point = 0; point < numPoints; ++point)
+    {
+        const auto x = bounds.getX() + bounds.getWidth() * static_cast<float>(point) / static_cast<float>(numPoints - 1);
+        const auto y = toY(bounds, values[static_cast<size_t>(point)]);
+
+        if (point == 0)
+            path.startNewSubPath(x, y);
+        else
+            path.lineTo(x, y);
+    }
+}
+
+//==============================================================================
+ScopeDisplay::ScopeDisplay()
+{
+    setOpaque(true);
+    points.resize(numPoints);
+}
+
+void ScopeDisplay::addPoints (const ScopeFeed::Point* newPoints, int numNewPoints)
+{
+    if (numNewPoints <= 0)
+        return;
+
+    // only the newest numPoints can ever be seen
+    const auto skipped = juce::jmax(0, numNewPoints - numPoints);
+
+    for (int index = skipped; index < numNewPoints; ++index)
+    {
+        points[static_cast<size_t>(writeIndex)] = newPoints[index];
+        writeIndex = (writeIndex + 1) % numPoints;
+    }
+
+    repaint();
+}
+
+void ScopeDisplay::paint (juce::Graphics& g)
+{
+    g.fillAll(backgroundColour);
+
+    const auto bounds = getLocalBounds().toFloat();
+    drawGrid(g, bounds);
+
+    // one vertical line per point, oldest on the left, spanning the point's min to max
+    g.setColour(traceColour);
+    const auto columnWidth = bounds.getWidth() / static_cast<float>(numPoints);
+
+    for (int column = 0; column < numPoints; ++column)
+    {
+        const auto& point = points[static_cast<size_t>((writeIndex + column) % numPoints)];
+        const auto x = bounds.getX() + columnWidth * static_cast<float>(column);
+        const auto top = toY(bounds, point.max);
+        const auto bottom = toY(bounds, point.min);
+
+        g.fillRect(x, top, juce::jmax(1.0f, columnWidth), juce::jmax(1.0f, bottom - top));
+    }
+}
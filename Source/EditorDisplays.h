@@ -0,0 +1,85 @@
+/*
+  ==============================================================================
+
+    EditorDisplays.h
+
+    The editor's two displays: the transfer curve of the current chain of
+    models and drives, and a scope of the output. Both are opaque and only repaint
+    themselves, and only when what they show has changed, so the rest of
+    the editor is never redrawn for them.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ScopeFeed.h"
+#include "DistortionParameters.h"
+
+//==============================================================================
+/** Output level against input level, for inputs between -1 and 1. The tilt filters between chain stages
+    depend on frequency, so the curve leaves them out.
+*/
+class TransferCurveDisplay  : public juce::Component
+{
+public:
+    TransferCurveDisplay();
+
+    /** One shaper of the chain. */
+    struct Shaper
+    {
+        int model = -1;
+        float drive = 1.0f;
+
+        bool operator== (const Shaper& other) const noexcept    { return model == other.model && drive == other.drive; }
+        bool operator!= (const Shaper& other) const noexcept    { return ! operator== (other); }
+    };
+
+    static constexpr int maxShapers = StageParameters::maxChainStages;
+
+    /** Recomputes the curve if the chain differs from the last call. Message thread. */
+    void setCurve (const Shaper* newShapers, int numNewShapers);
+
+    void paint (juce::Graphics& g) override;
+    void resized() override;
+
+private:
+    void updatePath();
+
+    std::array<Shaper, maxShapers> shapers;
+    int numShapers {0};
+
+    // output values at evenly spaced inputs across [-1, 1], and the path built from them for the current size
+    std::vector<float> values;
+    juce::Path path;
+
+    static constexpr int numPoints = 256;
+
+    //==============================================================================
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TransferCurveDisplay)
+};
+
+//==============================================================================
+/** Scrolling min/max envelope of the output, fed with points from a ScopeFeed. */
+class ScopeDisplay  : public juce::Component
+{
+public:
+    ScopeDisplay();
+
+    /** Appends points, dropping the oldest, and repaints. Message thread. */
+    void addPoints (const ScopeFeed::Point* newPoints, int numNewPoints);
+
+    void paint (juce::Graphics& g) override;
+
+    // about half a second of output at ScopeFeed::pointsPerSecond
+    static constexpr int numPoints = 512;
+
+private:
+    // circular, with writeIndex at the oldest point
+    std::vector<ScopeFeed::Point> points;
+    int writeIndex {0};
+
+    //==============================================================================
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ScopeDisplay)
+};
@@ -0,0 +1,288 @@
+/*
+  ==============================================================================
+
+    FastMath.h
+
+    Branch-free maths primitives that work on both plain samples and
+    juce::dsp::SIMDRegister, so each distortion model can be written once and
+    run either one sample or a full register at a time.
+
+    atan and sin come in two accuracy tiers: the plain versions are accurate
+    to better than -120 dB, the Eco versions to around -75 dB for roughly
+    half the arithmetic. All of them are constexpr for plain samples.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace FastMath
+{
+    //==============================================================================
+    template <typename Vec>
+    struct Element { using type = Vec; };
+
+   #if JUCE_USE_SIMD
+    template <typename T>
+    struct Element<juce::dsp::SIMDRegister<T>> { using type = T; };
+   #endif
+
+    /** The sample type held by a scalar or a SIMDRegister. */
+    template <typename Vec>
+    using ElementType = typename Element<Vec>::type;
+
+    template <typename Vec>
+    constexpr bool isScalar = std::is_floating_point<Vec>::value;
+
+    //==============================================================================
+   #if JUCE_USE_SIMD
+    // SIMDRegister has no division, so fall through to the native instruction where there is one
+    #if JUCE_USE_SSE_INTRINSICS
+     inline __m128  nativeDivide (__m128 a, __m128 b) noexcept     { return _mm_div_ps (a, b); }
+     inline __m128d nativeDivide (__m128d a, __m128d b) noexcept   { return _mm_div_pd (a, b); }
+     #if defined (__AVX__)
+      inline __m256  nativeDivide (__m256 a, __m256 b) noexcept    { return _mm256_div_ps (a, b); }
+      inline __m256d nativeDivide (__m256d a, __m256d b) noexcept  { return _mm256_div_pd (a, b); }
+     #endif
+    #elif JUCE_USE_ARM_NEON
+     #if defined (__aarch64__) || defined (_M_ARM64)
+      inline float32x4_t nativeDivide (float32x4_t a, float32x4_t b) noexcept { return vdivq_f32 (a, b); }
+     #else
+      inline float32x4_t nativeDivide (float32x4_t a, float32x4_t b) noexcept
+      {
+          // reciprocal estimate refined with two Newton-Raphson steps
+          auto r = vrecpeq_f32 (b);
+          r = vmulq_f32 (vrecpsq_f32 (b, r), r);
+          r = vmulq_f32 (vrecpsq_f32 (b, r), r);
+          return vmulq_f32 (a, r);
+      }
+     #endif
+    #endif
+
+    template <typename Vec, typename = void>
+    struct HasNativeDivide : std::false_type {};
+
+    template <typename Vec>
+    struct HasNativeDivide<Vec, decltype ((void) nativeDivide (std::declval<typename Vec::vSIMDType>(),
+                                                               std::declval<typename Vec::vSIMDType>()))> : std::true_type {};
+   #endif
+
+    //==============================================================================
+    template <typename Vec>
+    constexpr Vec splat (ElementType<Vec> value) noexcept
+    {
+        if constexpr (isScalar<Vec>)
+            return value;
+        else
+            return Vec::expand (value);
+    }
+
+    template <typename Vec>
+    constexpr Vec min (Vec a, Vec b) noexcept
+    {
+        if constexpr (isScalar<Vec>)
+            return b < a ? b : a;
+        else
+            return Vec::min (a, b);
+    }
+
+    template <typename Vec>
+    constexpr Vec max (Vec a, Vec b) noexcept
+    {
+        if constexpr (isScalar<Vec>)
+            return a < b ? b : a;
+        else
+            return Vec::max (a, b);
+    }
+
+    template <typename Vec>
+    constexpr Vec abs (Vec a) noexcept
+    {
+        if constexpr (isScalar<Vec>)
+            return a < Vec (0) ? -a : a;
+        else
+            return Vec::max (a, Vec::expand (0) - a);
+    }
+
+    /** Returns a true lane (or bool) wherever a < b. */
+    template <typename Vec>
+    constexpr auto lessThan (Vec a, Vec b) noexcept
+    {
+        if constexpr (isScalar<Vec>)
+            return a < b;
+        else
+            return Vec::lessThan (a, b);
+    }
+
+    /** Picks a where the mask is set and b elsewhere, without branching in the SIMD case. */
+    template <typename Mask, typename Vec>
+    constexpr Vec select (Mask mask, Vec a, Vec b) noexcept
+    {
+        if constexpr (isScalar<Vec>)
+            return mask ? a : b;
+        else
+            return (a & mask) + (b & ~mask); // the masked-out half is +0, so adding merges the two
+    }
+
+    /** Rounds towards zero wherever |a| < 2^31. Larger values, infinities and NaN come back unchanged,
+        the same in both paths, so no lane ever converts an integer it cannot hold.
+    */
+    template <typename Vec>
+    constexpr Vec truncate (Vec a) noexcept
+    {
+        const auto inRange = lessThan (abs (a), splat<Vec> (static_cast<ElementType<Vec>> (2147483648.0)));
+
+        if constexpr (isScalar<Vec>)
+            return inRange ? static_cast<Vec> (static_cast<long long> (a)) : a;
+        else
+            return select (inRange, Vec::truncate (select (inRange, a, splat<Vec> (0))), a);
+    }
+
+    template <typename Vec>
+    constexpr Vec divide (Vec a, Vec b) noexcept
+    {
+        if constexpr (isScalar<Vec>)
+        {
+            return a / b;
+        }
+       #if JUCE_USE_SIMD
+        else if constexpr (HasNativeDivide<Vec>::value)
+        {
+            return Vec::fromNative (nativeDivide (a.value, b.value));
+        }
+        else
+        {
+            auto result = Vec::expand (0);
+
+            for (size_t i = 0; i < Vec::SIMDNumElements; ++i)
+                result.set (i, a.get (i) / b.get (i));
+
+            return result;
+        }
+       #endif
+    }
+
+    //==============================================================================
+    /** atan on the whole real line. Reduces to [0, 1] and evaluates the
+        Abramowitz & Stegun 4.4.49 polynomial (absolute error below 2e-8).
+    */
+    template <typename Vec>
+    constexpr Vec atan (Vec x) noexcept
+    {
+        using E = ElementType<Vec>;
+
+        const auto one = splat<Vec> (1);
+        const auto a = abs (x);
+
+        // atan(a) = pi/2 - atan(1/a) for a > 1
+        const auto t = divide (min (a, one), max (a, one));
+        const auto t2 = t * t;
+
+        auto p = t2 * static_cast<E> (0.0028662257) + static_cast<E> (-0.0161657367);
+        p = p * t2 + static_cast<E> (0.0429096138);
+        p = p * t2 + static_cast<E> (-0.0752896400);
+        p = p * t2 + static_cast<E> (0.1065626393);
+        p = p * t2 + static_cast<E> (-0.1420889944);
+        p = p * t2 + static_cast<E> (0.1999355085);
+        p = p * t2 + static_cast<E> (-0.3333314528);
+        p = p * t2 + static_cast<E> (1.0);
+
+        auto r = t * p;
+        r = select (lessThan (one, a), splat<Vec> (juce::MathConstants<E>::halfPi) - r, r);
+
+        return select (lessThan (x, splat<Vec> (0)), splat<Vec> (0) - r, r);
+    }
+
+    /** Wraps x to [-pi, pi] and folds it to [-pi/2, pi/2] using sin(pi - r) = sin(r). */
+    template <typename Vec>
+    constexpr Vec wrapToHalfPi (Vec x) noexcept
+    {
+        using E = ElementType<Vec>;
+
+        const auto pi = splat<Vec> (juce::MathConstants<E>::pi);
+        const auto halfPi = splat<Vec> (juce::MathConstants<E>::halfPi);
+        const auto twoPi = juce::MathConstants<E>::twoPi;
+
+        // wrap to [-pi, pi]. 2pi is split in two so n * 2pi stays exact for the large part
+        const auto n = truncate (x * static_cast<E> (1.0 / (2.0 * juce::MathConstants<double>::pi)));
+        auto r = x - n * static_cast<E> (6.28125);
+        r = r - n * static_cast<E> (2.0 * juce::MathConstants<double>::pi - 6.28125);
+        r = select (lessThan (pi, r), r - twoPi, r);
+        r = select (lessThan (r, splat<Vec> (0) - pi), r + twoPi, r);
+
+        // fold to [-pi/2, pi/2]
+        r = select (lessThan (halfPi, r), pi - r, r);
+        r = select (lessThan (r, splat<Vec> (0) - halfPi), splat<Vec> (0) - pi - r, r);
+
+        return r;
+    }
+
+    /** sin on the whole real line. Wraps to [-pi, pi], folds to [-pi/2, pi/2]
+        and evaluates the Taylor series to x^11 (absolute error below 6e-8).
+    */
+    template <typename Vec>
+    constexpr Vec sin (Vec x) noexcept
+    {
+        using E = ElementType<Vec>;
+
+        const auto r = wrapToHalfPi (x);
+        const auto r2 = r * r;
+
+        auto p = r2 * static_cast<E> (-1.0 / 39916800.0) + static_cast<E> (1.0 / 362880.0);
+        p = p * r2 + static_cast<E> (-1.0 / 5040.0);
+        p = p * r2 + static_cast<E> (1.0 / 120.0);
+        p = p * r2 + static_cast<E> (-1.0 / 6.0);
+        p = p * r2 + static_cast<E> (1.0);
+
+        return r * p;
+    }
+
+    //==============================================================================
+    /** Cheaper atan: the [5/4] Pade approximant on [0, 1], folded with the range
+        reduction so that only one division is needed (absolute error below 2e-4).
+    */
+    template <typename Vec>
+    constexpr Vec atanEco (Vec x) noexcept
+    {
+        using E = ElementType<Vec>;
+
+        const auto one = splat<Vec> (1);
+
+        // clamped so d^5 below can't overflow; atan is flat to float precision out there anyway
+        const auto a = min (abs (x), splat<Vec> (static_cast<E> (1.0e6)));
+
+        // t = n / d is the reduced argument, as in atan()
+        const auto n = min (a, one);
+        const auto d = max (a, one);
+        const auto n2 = n * n;
+        const auto d2 = d * d;
+
+        const auto num = n * ((d2 * static_cast<E> (945) + n2 * static_cast<E> (735)) * d2 + n2 * n2 * static_cast<E> (64));
+        const auto den = d * ((d2 * static_cast<E> (945) + n2 * static_cast<E> (1050)) * d2 + n2 * n2 * static_cast<E> (225));
+
+        auto r = divide (num, den);
+        r = select (lessThan (one, a), splat<Vec> (juce::MathConstants<E>::halfPi) - r, r);
+
+        return select (lessThan (x, splat<Vec> (0)), splat<Vec> (0) - r, r);
+    }
+
+    /** Cheaper sin: same range reduction as sin(), then Hastings' fifth order
+        polynomial (absolute error below 2e-4).
+    */
+    template <typename Vec>
+    constexpr Vec sinEco (Vec x) noexcept
+    {
+        using E = ElementType<Vec>;
+
+        const auto r = wrapToHalfPi (x);
+        const auto r2 = r * r;
+
+        return r * ((r2 * static_cast<E> (0.00761) + static_cast<E> (-0.16605)) * r2 + static_cast<E> (1.0));
+    }
+
+    // the scalar versions are usable at compile time
+    static_assert (atan (1.0) > 0.7853981 && atan (1.0) < 0.7853982, "atan approximation is out of tolerance");
+    static_assert (sin (1.0) > 0.8414709 && sin (1.0) < 0.8414710, "sin approximation is out of tolerance");
+}
@@ -0,0 +1,205 @@
+/*
+  ==============================================================================
+
+    Instrumentation.cpp
+
+  ==============================================================================
+*/
+
+#include "Instrumentation.h"
+
+namespace
+{
+    struct Registry
+    {
+        juce::CriticalSection lock;
+        juce::Array<Instrumentation*> instances;
+    };
+
+    Registry& getRegistry()
+    {
+        static Registry registry;
+        return registry;
+    }
+}
+
+//==============================================================================
+Instrumentation::Instrumentation()
+{
+    auto& registry = getRegistry();
+    const juce::ScopedLock sl (registry.lock);
+    registry.instances.add(this);
+}
+
+Instrumentation::~Instrumentation()
+{
+    stopTimer();
+
+    auto& registry = getRegistry();
+    const juce::ScopedLock sl (registry.lock);
+    registry.instances.removeFirstMatchingValue(this);
+}
+
+void Instrumentation::attachReader()
+{
+    // the first reader starts collection, so the fifo has exactly one consumer however many readers there are
+    if (++numReaders == 1)
+        startTimer(reportIntervalMs);
+}
+
+void Instrumentation::detachReader()
+{
+    if (--numReaders == 0)
+        stopTimer();
+}
+
+Instrumentation::Report Instrumentation::getLatestReport() const
+{
+    const juce::ScopedLock sl (reportLock);
+    return latestReport;
+}
+
+void Instrumentation::timerCallback()
+{
+    const auto report = drain();
+
+    const juce::ScopedLock sl (reportLock);
+    latestReport = report;
+}
+
+void Instrumentation::forEachInstance (const std::function<void (Instrumentation&)>& function)
+{
+    auto& registry = getRegistry();
+    const juce::ScopedLock sl (registry.lock);
+
+    for (auto* instance : registry.instances)
+        function(*instance);
+}
+
+//==============================================================================
+void Instrumentation::push (const BlockStats& stats) noexcept
+{
+    const auto scope = fifo.write(1);
+
+    if (scope.blockSize1 > 0)
+        blocks[static_cast<size_t>(scope.startIndex1)] = stats;
+    else
+        droppedBlocks.fetch_add(1, std::memory_order_relaxed);
+}
+
+Instrumentation::Report Instrumentation::collect()
+{
+    // with a reader attached, the timer is already draining the fifo
+    jassert (numReaders.load() == 0);
+    return drain();
+}
+
+Instrumentation::Report Instrumentation::drain()
+{
+    Report report;
+    report.droppedBlocks = droppedBlocks.exchange(0, std::memory_order_relaxed);
+
+    juce::int64 sampleCount = 0; // samples times channels, which is what the per-sample times are divided by
+    double sumOfSquares = 0.0;
+
+    struct Totals
+    {
+        juce::int64 ticks = 0;
+        juce::int64 slowest = 0;
+
+        void add (juce::int64 blockTicks) noexcept
+        {
+            ticks += blockTicks;
+            slowest = juce::jmax(slowest, blockTicks);
+        }
+    };
+
+    Totals preFilter, upsample, shape, downsample, postFilter, total;
+
+    const auto readBlocks = [&] (int start, int size)
+    {
+        for (int index = start; index < start + size; ++index)
+        {
+            const auto& stats = blocks[static_cast<size_t>(index)];
+            const auto samples = static_cast<juce::int64>(stats.numSamples) * stats.numChannels;
+
+            ++report.numBlocks;
+            report.idleBlocks += stats.idle ? 1 : 0;
+            report.numSamples += stats.numSamples;
+            sampleCount += samples;
+
+            preFilter.add(stats.preFilterTicks);
+            upsample.add(stats.upsampleTicks);
+            shape.add(stats.shapeTicks);
+            downsample.add(stats.downsampleTicks);
+            postFilter.add(stats.postFilterTicks);
+            total.add(stats.totalTicks);
+
+            report.inputPeak = juce::jmax(report.inputPeak, stats.inputPeak);
+            report.outputPeak = juce::jmax(report.outputPeak, stats.outputPeak);
+            sumOfSquares += static_cast<double>(stats.outputMeanSquare) * static_cast<double>(samples);
+            report.clippedSamples += stats.clippedSamples;
+        }
+    };
+
+    {
+        const auto scope = fifo.read(fifo.getNumReady());
+        readBlocks(scope.startIndex1, scope.blockSize1);
+        readBlocks(scope.startIndex2, scope.blockSize2);
+    }
+
+    const auto toStageTime = [sampleCount] (const Totals& totals)
+    {
+        StageTime time;
+
+        if (sampleCount > 0)
+            time.nanosecondsPerSample = juce::Time::highResolutionTicksToSeconds(totals.ticks) * 1.0e9 / static_cast<double>(sampleCount);
+
+        time.slowestBlockMicroseconds = juce::Time::highResolutionTicksToSeconds(totals.slowest) * 1.0e6;
+        return time;
+    };
+
+    report.preFilter = toStageTime(preFilter);
+    report.upsample = toStageTime(upsample);
+    report.shape = toStageTime(shape);
+    report.downsample = toStageTime(downsample);
+    report.postFilter = toStageTime(postFilter);
+    report.total = toStageTime(total);
+
+    if (sampleCount > 0)
+        report.outputRms = static_cast<float>(std::sqrt(sumOfSquares / static_cast<double>(sampleCount)));
+
+    return report;
+}
+
+//==============================================================================
+juce::var Instrumentation::Report::toVar() const
+{
+    const auto stageToVar = [] (const StageTime& time)
+    {
+        auto* object = new juce::DynamicObject();
+        object->setProperty("ns_per_sample", time.nanosecondsPerSample);
+        object->setProperty("slowest_block_us", time.slowestBlockMicroseconds);
+        return juce::var(object);
+    };
+
+    auto* stages = new juce::DynamicObject();
+    stages->setProperty("pre_filter", stageToVar(preFilter));
+    stages->setProperty("upsample", stageToVar(upsample));
+    stages->setProperty("shape", stageToVar(shape));
+    stages->setProperty("downsample", stageToVar(downsample));
+    stages->setProperty("post_filter", stageToVar(postFilter));
+    stages->setProperty("total", stageToVar(total));
+
+    auto* object = new juce::DynamicObject();
+    object->setProperty("blocks", numBlocks);
+    object->setProperty("idle_blocks", idleBlocks);
+    object->setProperty("dropped_blocks", droppedBlocks);
+    object->setProperty("samples", numSamples);
+    object->setProperty("stages", juce::var(stages));
+    object->setProperty("input_peak_db", juce::Decibels::gainToDecibels(inputPeak));
+    object->setProperty("output_peak_db", juce::Decibels::gainToDecibels(outputPeak));
+    object->setProperty("output_rms_db", juce::Decibels::gainToDecibels(outputRms));
+    object->setProperty("clipped_samples", clippedSamples);
+    return juce::var(object);
+}
@@ -0,0 +1,137 @@
+/*
+  ==============================================================================
+
+    Instrumentation.h
+
+    Per-block timing and level statistics, passed from the audio thread to
+    whoever wants to look at them without locks on the audio side.
+
+    The engine fills a BlockStats every block: time spent in each stage of
+    the chain, and the input peak, output peak, output mean square and the
+    number of output samples over 0 dBFS. The processor pushes it into a
+    single-producer single-consumer ring buffer (an AbstractFifo), which is
+    wait-free for the audio thread. If the buffer is full the block is
+    dropped and counted rather than waited for.
+
+    Measuring is off until something wants to look. A live reader, like the
+    editor, attaches while it is open. The instance then drains the buffer
+    itself once per report interval, on the message thread, and keeps the
+    last Report for any number of readers to copy with getLatestReport().
+    That keeps a single consumer on the buffer however many readers there
+    are. Every live instance is listed in a registry, so a dashboard can
+    attach to all of them and poll them from one place with
+    forEachInstance(). The registry is locked, but only from the
+    constructor, the destructor and forEachInstance(), never from the audio
+    thread.
+
+    An offline tool with no message loop enables measuring with setEnabled()
+    instead, and drains the buffer itself with collect(). It must not attach
+    a reader as well.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/** What the engine measured over one block. Times are in high resolution ticks. */
+struct BlockStats
+{
+    int numSamples = 0;
+    int numChannels = 0;
+    bool idle = false;  // skipped as silence
+
+    juce::int64 preFilterTicks = 0;
+    juce::int64 upsampleTicks = 0;
+    juce::int64 shapeTicks = 0;
+    juce::int64 downsampleTicks = 0;
+    juce::int64 postFilterTicks = 0;
+    juce::int64 totalTicks = 0;
+
+    float inputPeak = 0.0f;
+    float outputPeak = 0.0f;
+    float outputMeanSquare = 0.0f;
+    int clippedSamples = 0;
+};
+
+//==============================================================================
+/**
+*/
+class Instrumentation  : private juce::Timer
+{
+public:
+    Instrumentation();
+    ~Instrumentation();
+
+    /** Timing for one stage over a report. */
+    struct StageTime
+    {
+        double nanosecondsPerSample = 0.0;   // per sample of every channel, over all the blocks
+        double slowestBlockMicroseconds = 0.0;
+    };
+
+    /** Everything collected since the previous report. */
+    struct Report
+    {
+        int numBlocks = 0;
+        int idleBlocks = 0;
+        int droppedBlocks = 0;
+        juce::int64 numSamples = 0;
+
+        StageTime preFilter, upsample, shape, downsample, postFilter, total;
+
+        float inputPeak = 0.0f;
+        float outputPeak = 0.0f;
+        float outputRms = 0.0f;
+        juce::int64 clippedSamples = 0;
+
+        /** The report as a JSON-friendly object, with levels in dBFS. */
+        juce::var toVar() const;
+    };
+
+    /** Measuring costs a few clock reads and an extra pass over the input and output per block,
+        so it only runs while a reader is attached or an offline tool has switched it on.
+    */
+    bool isEnabled() const noexcept    { return enabled || numReaders.load(std::memory_order_relaxed) > 0; }
+
+    /** Attaching starts measuring and collecting, detaching stops both again once no reader is left. */
+    void attachReader();
+    void detachReader();
+
+    /** The report collected over the last interval. Any thread, while attached. */
+    Report getLatestReport() const;
+
+    /** Offline tools only: measures without a reader attached, for a caller that drains with collect(). */
+    void setEnabled (bool shouldBeEnabled) noexcept    { enabled = shouldBeEnabled; }
+
+    /** Audio thread. Wait-free, and drops the block if the reader has fallen behind. */
+    void push (const BlockStats& stats) noexcept;
+
+    /** Offline tools only. Drains everything pushed since the last call, on the one thread that collects. */
+    Report collect();
+
+    /** Calls the function for every live instance, with the registry locked, so none can be deleted meanwhile. */
+    static void forEachInstance (const std::function<void (Instrumentation&)>& function);
+
+    static constexpr int capacity = 2048;
+    static constexpr int reportIntervalMs = 1000;
+
+private:
+    //==============================================================================
+    void timerCallback() override;
+    Report drain();
+
+    juce::AbstractFifo fifo {capacity};
+    std::array<BlockStats, capacity> blocks;
+    std::atomic<int> droppedBlocks {0};
+    std::atomic<bool> enabled {false};
+    std::atomic<int> numReaders {0};
+
+    juce::CriticalSection reportLock;
+    Report latestReport;
+
+    //==============================================================================
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Instrumentation)
+};
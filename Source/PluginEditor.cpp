@@ -1,7 +1,7 @@
 /*
   ==============================================================================
 
-    This file contains the basic framework code for a JUCE plugin editor.
+    PluginEditor.cpp
 
   ==============================================================================
 */
@@ -13,13 +13,54 @@
 DistortionOversamplingAudioProcessorEditor::DistortionOversamplingAudioProcessorEditor (DistortionOversamplingAudioProcessor& p)
     : AudioProcessorEditor (&p), audioProcessor (p)
 {
+    for (auto* parameter : audioProcessor.getParameters())
+        if (auto* ranged = dynamic_cast<juce::RangedAudioParameter*>(parameter))
+            addControl(*ranged);
+
+    controlPanel.setSize(320, controls.size() * rowHeight);
+    viewport.setViewedComponent(&controlPanel, false);
+    viewport.setScrollBarsShown(true, false);
+    addAndMakeVisible(viewport);
+
+    addAndMakeVisible(transferCurve);
+    addAndMakeVisible(scope);
+
+    status.setFont(juce::Font(13.0f));
+    status.setJustificationType(juce::Justification::centredLeft);
+    addAndMakeVisible(status);
+
+    // the first stage is the full-band model and drive
+    auto& treeState = audioProcessor.treeState;
+    numChainStages = treeState.getRawParameterValue("chain stages");
+    numBands = treeState.getRawParameterValue("bands");
+    models[0] = treeState.getRawParameterValue("model");
+    drives[0] = treeState.getRawParameterValue("input");
+
+    for (int index = 1; index < TransferCurveDisplay::maxShapers; ++index)
+    {
+        const auto prefix = "stage " + juce::String(index + 1) + " ";
+        models[static_cast<size_t>(index)] = treeState.getRawParameterValue(prefix + "model");
+        drives[static_cast<size_t>(index)] = treeState.getRawParameterValue(prefix + "drive");
+    }
+
+    updateTransferCurve();
+
+    // the audio thread only feeds the scope and measures while at least one editor is reading them
+    scopePoints.resize(ScopeFeed::capacity);
+    audioProcessor.getScopeFeed().attachReader();
+    audioProcessor.getInstrumentation().attachReader();
+    startTimerHz(frameRate);
+
     // Make sure that before the constructor has finished, you've set the
     // editor's size to whatever you need it to be.
-    setSize (400, 300);
+    setSize (760, 440);
 }
 
 DistortionOversamplingAudioProcessorEditor::~DistortionOversamplingAudioProcessorEditor()
 {
+    stopTimer();
+    audioProcessor.getScopeFeed().detachReader();
+    audioProcessor.getInstrumentation().detachReader();
 }
 
 //==============================================================================
@@ -27,14 +68,107 @@ void DistortionOversamplingAudioProcessorEditor::paint (juce::Graphics& g)
 {
     // (Our component is opaque, so we must completely fill the background with a solid colour)
     g.fillAll (getLookAndFeel().findColour (juce::ResizableWindow::backgroundColourId));
-
-    g.setColour (juce::Colours::white);
-    g.setFont (15.0f);
-    g.drawFittedText ("Hello World!", getLocalBounds(), juce::Justification::centred, 1);
 }
 
 void DistortionOversamplingAudioProcessorEditor::resized()
 {
-    // This is generally where you'll want to lay out the positions of any
-    // subcomponents in your editor..
+    auto bounds = getLocalBounds().reduced(8);
+
+    viewport.setBounds(bounds.removeFromLeft(340));
+    controlPanel.setSize(viewport.getMaximumVisibleWidth(), controlPanel.getHeight());
+
+    for (int row = 0; row < controls.size(); ++row)
+    {
+        auto rowBounds = juce::Rectangle<int> (0, row * rowHeight, controlPanel.getWidth(), rowHeight).reduced(2);
+        labels[row]->setBounds(rowBounds.removeFromLeft(130));
+        controls[row]->setBounds(rowBounds);
+    }
+
+    bounds.removeFromLeft(8);
+    status.setBounds(bounds.removeFromBottom(20));
+    bounds.removeFromBottom(8);
+
+    transferCurve.setBounds(bounds.removeFromTop(bounds.getHeight() / 2));
+    bounds.removeFromTop(8);
+    scope.setBounds(bounds);
+}
+
+//==============================================================================
+void DistortionOversamplingAudioProcessorEditor::timerCallback()
+{
+    const auto numPoints = audioProcessor.getScopeFeed().pull(scopePoints.data(), static_cast<int>(scopePoints.size()));
+    scope.addPoints(scopePoints.data(), numPoints);
+
+    updateTransferCurve();
+
+    // the bands choice starts at one band
+    if (globalMix != nullptr)
+        globalMix->setEnabled(numBands->load() < 0.5f);
+
+    if (--framesUntilStatus > 0)
+        return;
+
+    framesUntilStatus = frameRate;
+
+    // the label only repaints when the text is different
+    const auto report = audioProcessor.getInstrumentation().getLatestReport();
+    juce::String text;
+
+    if (report.numBlocks > 0)
+        text << juce::String(report.total.nanosecondsPerSample, 1) << " ns/sample, slowest block "
+             << juce::String(report.total.slowestBlockMicroseconds, 0) << " us, output peak "
+             << juce::String(juce::Decibels::gainToDecibels(report.outputPeak), 1) << " dBFS, "
+             << report.clippedSamples << " samples clipped";
+
+    status.setText(text, juce::dontSendNotification);
+}
+
+void DistortionOversamplingAudioProcessorEditor::updateTransferCurve()
+{
+    std::array<TransferCurveDisplay::Shaper, TransferCurveDisplay::maxShapers> shapers;
+    const auto numShapers = juce::jlimit(1, TransferCurveDisplay::maxShapers, static_cast<int>(numChainStages->load()) + 1);
+
+    for (int index = 0; index < numShapers; ++index)
+    {
+        shapers[static_cast<size_t>(index)].model = static_cast<int>(models[static_cast<size_t>(index)]->load());
+        shapers[static_cast<size_t>(index)].drive = juce::Decibels::decibelsToGain(drives[static_cast<size_t>(index)]->load());
+    }
+
+    transferCurve.setCurve(shapers.data(), numShapers);
+}
+
+void DistortionOversamplingAudioProcessorEditor::addControl (juce::RangedAudioParameter& parameter)
+{
+    auto& treeState = audioProcessor.treeState;
+    const auto& id = parameter.paramID;
+
+    auto* label = labels.add(new juce::Label({}, parameter.getName(32)));
+    controlPanel.addAndMakeVisible(label);
+
+    if (auto* choice = dynamic_cast<juce::AudioParameterChoice*>(&parameter))
+    {
+        // items have to be there before the attachment sets the selection
+        auto* comboBox = new juce::ComboBox();
+        comboBox->addItemList(choice->choices, 1);
+        comboBoxAttachments.add(new juce::AudioProcessorValueTreeState::ComboBoxAttachment(treeState, id, *comboBox));
+        controls.add(comboBox);
+    }
+    else if (dynamic_cast<juce::AudioParameterBool*>(&parameter) != nullptr)
+    {
+        auto* button = new juce::ToggleButton();
+        buttonAttachments.add(new juce::AudioProcessorValueTreeState::ButtonAttachment(treeState, id, *button));
+        controls.add(button);
+    }
+    else
+    {
+        auto* slider = new juce::Slider(juce::Slider::LinearHorizontal, juce::Slider::TextBoxRight);
+        slider->setTextBoxStyle(juce::Slider::TextBoxRight, false, 64, rowHeight - 4);
+        sliderAttachments.add(new juce::AudioProcessorValueTreeState::SliderAttachment(treeState, id, *slider));
+        controls.add(slider);
+    }
+
+    controlPanel.addAndMakeVisible(controls.getLast());
+
+    if (id == "mix")
+        globalMix = controls.getLast();
 }
@@ -1,7 +1,18 @@
 /*
   ==============================================================================
 
-    This file contains the basic framework code for a JUCE plugin editor.
+    PluginEditor.h
+
+    A control for every parameter, with the transfer curve of the current
+    chain and a scope of the output beside them.
+
+    Everything that moves is driven from one timer at frameRate: the scope
+    pulls the points the audio thread has pushed since the last frame, the
+    curve checks whether a model or drive changed, and once a second the
+    latest instrumentation report goes into the status line. Each of those only
+    repaints its own component, and only when there is something new. The
+    controls follow the parameters through attachments, which are listeners
+    rather than timers, so an editor costs nothing while nothing changes.
 
   ==============================================================================
 */
@@ -10,11 +21,12 @@
 
 #include <JuceHeader.h>
 #include "PluginProcessor.h"
+#include "EditorDisplays.h"
 
 //==============================================================================
 /**
 */
-class DistortionOversamplingAudioProcessorEditor  : public juce::AudioProcessorEditor
+class DistortionOversamplingAudioProcessorEditor  : public juce::AudioProcessorEditor, private juce::Timer
 {
 public:
     DistortionOversamplingAudioProcessorEditor (DistortionOversamplingAudioProcessor&);
@@ -24,10 +36,47 @@ public:
     void paint (juce::Graphics&) override;
     void resized() override;
 
+    static constexpr int frameRate = 30;
+
 private:
+    void timerCallback() override;
+
+    // adds a label and a control matching the parameter's type to the control panel
+    void addControl (juce::RangedAudioParameter& parameter);
+
     // This reference is provided as a quick way for your editor to
     // access the processor object that created it.
     DistortionOversamplingAudioProcessor& audioProcessor;
 
+    // controls, one row per parameter, scrolling inside the viewport
+    juce::Viewport viewport;
+    juce::Component controlPanel;
+    juce::OwnedArray<juce::Label> labels;
+    juce::OwnedArray<juce::Component> controls;
+    juce::OwnedArray<juce::AudioProcessorValueTreeState::SliderAttachment> sliderAttachments;
+    juce::OwnedArray<juce::AudioProcessorValueTreeState::ComboBoxAttachment> comboBoxAttachments;
+    juce::OwnedArray<juce::AudioProcessorValueTreeState::ButtonAttachment> buttonAttachments;
+
+    TransferCurveDisplay transferCurve;
+    ScopeDisplay scope;
+    juce::Label status;
+
+    // what the curve is drawn from: the number of chain stages, and each stage's model and drive
+    void updateTransferCurve();
+
+    std::atomic<float>* numChainStages = nullptr;
+
+    // the full-band mix does nothing in multiband mode, so its control is greyed out there
+    std::atomic<float>* numBands = nullptr;
+    juce::Component* globalMix = nullptr;
+    std::array<std::atomic<float>*, TransferCurveDisplay::maxShapers> models {};
+    std::array<std::atomic<float>*, TransferCurveDisplay::maxShapers> drives {};
+
+    // points pulled from the scope feed each frame, sized once so the timer never allocates
+    std::vector<ScopeFeed::Point> scopePoints;
+    int framesUntilStatus {0};
+
+    static constexpr int rowHeight = 26;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DistortionOversamplingAudioProcessorEditor)
 };
@@ -19,32 +19,63 @@ DistortionOversamplingAudioProcessor::DistortionOversamplingAudioProcessor()
                       #endif
                        .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
                      #endif
-                       ), treeState(*this, nullptr, "PARAMETERS", createParameterLayout()), oversamplingModule(2, 2, juce::dsp::Oversampling<float>::filterHalfBandPolyphaseIIR)
+                       ), treeState(*this, nullptr, "PARAMETERS", createParameterLayout())
 #endif
 {
-    treeState.addParameterListener("oversample", this);
-    treeState.addParameterListener("pre tone", this);
-    treeState.addParameterListener("pre cutoff", this);
+    rawParameters.oversample = treeState.getRawParameterValue("oversample");
+    rawParameters.osFactor = treeState.getRawParameterValue("os factor");
+    rawParameters.osFilter = treeState.getRawParameterValue("os filter");
+    rawParameters.osAuto = treeState.getRawParameterValue("os auto");
+    rawParameters.aliasThreshold = treeState.getRawParameterValue("alias threshold");
+    rawParameters.preFilter = treeState.getRawParameterValue("pre tone");
+    rawParameters.preCutoff = treeState.getRawParameterValue("pre cutoff");
+    rawParameters.model = treeState.getRawParameterValue("model");
+    rawParameters.input = treeState.getRawParameterValue("input");
+    rawParameters.postFilter = treeState.getRawParameterValue("post tone");
+    rawParameters.postCutoff = treeState.getRawParameterValue("post cutoff");
+    rawParameters.phase = treeState.getRawParameterValue("phase");
+    rawParameters.mix = treeState.getRawParameterValue("mix");
+    rawParameters.precision = treeState.getRawParameterValue("precision");
+    rawParameters.engine = treeState.getRawParameterValue("engine");
+    rawParameters.tonePlacement = treeState.getRawParameterValue("tone placement");
+    rawParameters.numBands = treeState.getRawParameterValue("bands");
+    
+    for (int crossover = 0; crossover < DistortionParameters::maxBands - 1; ++crossover)
+        rawParameters.crossovers[static_cast<size_t>(crossover)] = treeState.getRawParameterValue("crossover " + juce::String(crossover + 1));
+    
+    for (int band = 0; band < DistortionParameters::maxBands; ++band)
+    {
+        const auto prefix = "band " + juce::String(band + 1) + " ";
+        auto& raw = rawParameters.bands[static_cast<size_t>(band)];
+        raw.model = treeState.getRawParameterValue(prefix + "model");
+        raw.drive = treeState.getRawParameterValue(prefix + "drive");
+        raw.mix = treeState.getRawParameterValue(prefix + "mix");
+        raw.oversample = treeState.getRawParameterValue(prefix + "oversample");
+        raw.bypass = treeState.getRawParameterValue(prefix + "bypass");
+    }
+    
+    rawParameters.numChainStages = treeState.getRawParameterValue("chain stages");
+    
+    for (int index = 0; index < StageParameters::maxChainStages - 1; ++index)
+    {
+        const auto prefix = "stage " + juce::String(index + 2) + " ";
+        auto& raw = rawParameters.chain[static_cast<size_t>(index)];
+        raw.model = treeState.getRawParameterValue(prefix + "model");
+        raw.drive = treeState.getRawParameterValue(prefix + "drive");
+        raw.tilt = treeState.getRawParameterValue(prefix + "tilt");
+    }
+    
+    // the audio thread reads everything else itself; these only kick off table rebuilds
     treeState.addParameterListener("model", this);
     treeState.addParameterListener("input", this);
-    treeState.addParameterListener("post tone", this);
-    treeState.addParameterListener("post cutoff", this);
-    treeState.addParameterListener("phase", this);
-    treeState.addParameterListener("mix", this);
+    treeState.addParameterListener("engine", this);
 }
 
 DistortionOversamplingAudioProcessor::~DistortionOversamplingAudioProcessor()
 {
-    treeState.removeParameterListener("oversample", this);
-    treeState.removeParameterListener("pre tone", this);
-    treeState.removeParameterListener("pre cutoff", this);
     treeState.removeParameterListener("model", this);
     treeState.removeParameterListener("input", this);
-    treeState.removeParameterListener("post tone", this);
-    treeState.removeParameterListener("post cutoff", this);
-    treeState.removeParameterListener("phase", this);
-    treeState.removeParameterListener("mix", this);
-    
+    treeState.removeParameterListener("engine", this);
 }
 
 juce::AudioProcessorValueTreeState::ParameterLayout DistortionOversamplingAudioProcessor::createParameterLayout()
@@ -52,11 +83,24 @@ juce::AudioProcessorValueTreeState::ParameterLayout DistortionOversamplingAudioP
     std::vector <std::unique_ptr<juce::RangedAudioParameter>> params;
     
     juce::StringArray disModels = {"Soft", "Hard", "Tube", "Half-Wave", "Full-Wave", "Sine"};
+    juce::StringArray precisions = {"Exact", "High", "Eco"};
+    juce::StringArray engines = {"Direct", "Table (Linear)", "Table (Hermite)", "ADAA"};
+    juce::StringArray osFactors = {"2x", "4x", "8x", "16x"};
+    juce::StringArray osFilters = {"IIR", "FIR (Linear Phase)"};
+    juce::StringArray tonePlacements = {"Host Rate", "Post Oversampled", "Pre + Post Oversampled"};
+    juce::StringArray bandCounts = {"1", "2", "3", "4"};
+    juce::StringArray chainCounts = {"1", "2", "3", "4"};
+    const float crossoverDefaults[] = {150.0f, 1000.0f, 5000.0f};
     
     //make sure to update number of reservations after adding params
-    params.reserve(9);
+    // 13 main, auto oversampling and its threshold, tone placement, the bands with their crossovers, and the chain
+    params.reserve(13 + 2 + 1
+                   + 1 + (DistortionParameters::maxBands - 1) + DistortionParameters::maxBands * 5
+                   + 1 + (StageParameters::maxChainStages - 1) * 3);
     
     auto pOSToggle = std::make_unique<juce::AudioParameterBool>("oversample", "Oversample", false);
+    auto pOSFactor = std::make_unique<juce::AudioParameterChoice>("os factor", "OS Factor", osFactors, 1);
+    auto pOSFilter = std::make_unique<juce::AudioParameterChoice>("os filter", "OS Filter", osFilters, 0);
     auto pPreFilter = std::make_unique<juce::AudioParameterBool>("pre tone", "Pre Tone", false);
     auto pPreCutoff = std::make_unique<juce::AudioParameterFloat>("pre cutoff", "Pre HP Cutoff", juce::NormalisableRange<float> (20.0, 20000.0, 1.0, 0.22), 20.0);
     auto pModels = std::make_unique<juce::AudioParameterChoice>("model", "Model", disModels, 0);
@@ -65,8 +109,12 @@ juce::AudioProcessorValueTreeState::ParameterLayout DistortionOversamplingAudioP
     auto pPostCutoff = std::make_unique<juce::AudioParameterFloat>("post cutoff", "Post LP Cutoff", juce::NormalisableRange<float> (20.0, 20000.0, 1.0, 0.22), 20000.0);
     auto pPhase = std::make_unique<juce::AudioParameterBool>("phase", "Phase", false);
     auto pMix = std::make_unique<juce::AudioParameterFloat>("mix", "Mix", 0.0, 1.0, 1.0);
+    auto pPrecision = std::make_unique<juce::AudioParameterChoice>("precision", "Precision", precisions, 1);
+    auto pEngine = std::make_unique<juce::AudioParameterChoice>("engine", "Engine", engines, 0);
     
     params.push_back(std::move(pOSToggle));
+    params.push_back(std::move(pOSFactor));
+    params.push_back(std::move(pOSFilter));
     params.push_back(std::move(pPreFilter));
     params.push_back(std::move(pPreCutoff));
     params.push_back(std::move(pModels));
@@ -75,61 +123,133 @@ juce::AudioProcessorValueTreeState::ParameterLayout DistortionOversamplingAudioP
     params.push_back(std::move(pPostCutoff));
     params.push_back(std::move(pPhase));
     params.push_back(std::move(pMix));
-
-    return { params.begin(), params.end() };
-}
-
-void DistortionOversamplingAudioProcessor::parameterChanged(const juce::String &parameterID, float newValue)
-{
-    if (parameterID == "oversample")
-    {
-        osToggle = newValue;
-        std::cout << osToggle << std::endl;
-    }
-    if (parameterID == "pre tone")
-    {
-        preFilter = newValue;
-    }
-    if (parameterID == "pre cutoff")
-    {
-        preCutoff = newValue;
-        preHighPassFilter.setCutoffFrequency(preCutoff);
-    }
-    if (parameterID == "model")
+    params.push_back(std::move(pPrecision));
+    params.push_back(std::move(pEngine));
+    
+    // automatic oversampling picks the factor each block, up to the selected one, from the predicted aliasing
+    params.push_back(std::make_unique<juce::AudioParameterBool>("os auto", "Auto Oversample", false));
+    params.push_back(std::make_unique<juce::AudioParameterFloat>("alias threshold", "Alias Threshold", -140.0, -40.0, -90.0));
+    
+    // the tone filters can move into the oversampled pass, next to the shaper
+    params.push_back(std::make_unique<juce::AudioParameterChoice>("tone placement", "Tone Placement", tonePlacements, 0));
+    
+    // multiband mode. With one band the full-band model, drive, mix and oversampling switch apply as before
+    params.push_back(std::make_unique<juce::AudioParameterChoice>("bands", "Bands", bandCounts, 0));
+    
+    for (int crossover = 0; crossover < DistortionParameters::maxBands - 1; ++crossover)
     {
-        switch (static_cast<int> (newValue))
-        {
-            case 0: disModel = DisModels::kSoft; break;
-            case 1: disModel = DisModels::kHard; break;
-            case 2: disModel = DisModels::kTube; break;
-            case 3: disModel = DisModels::kHalfWave; break;
-            case 4: disModel = DisModels::kFullWave; break;
-            case 5: disModel = DisModels::kSine; break;
-        }
-        DBG(static_cast<int>(disModel));
+        const auto number = juce::String(crossover + 1);
+        params.push_back(std::make_unique<juce::AudioParameterFloat>("crossover " + number, "Crossover " + number,
+                                                                     juce::NormalisableRange<float> (20.0, 20000.0, 1.0, 0.22), crossoverDefaults[crossover]));
     }
-    if (parameterID == "input")
+    
+    for (int band = 0; band < DistortionParameters::maxBands; ++band)
     {
-        dBInput = newValue;
-        rawInput = juce::Decibels::decibelsToGain(dBInput);
+        const auto id = "band " + juce::String(band + 1) + " ";
+        const auto name = "Band " + juce::String(band + 1) + " ";
+        
+        params.push_back(std::make_unique<juce::AudioParameterChoice>(id + "model", name + "Model", disModels, 0));
+        params.push_back(std::make_unique<juce::AudioParameterFloat>(id + "drive", name + "Drive", 0.0, 24.0, 0.0));
+        params.push_back(std::make_unique<juce::AudioParameterFloat>(id + "mix", name + "Mix", 0.0, 1.0, 1.0));
+        params.push_back(std::make_unique<juce::AudioParameterBool>(id + "oversample", name + "Oversample", false));
+        params.push_back(std::make_unique<juce::AudioParameterBool>(id + "bypass", name + "Bypass", false));
     }
-    if (parameterID == "post tone")
+    
+    // serial chain. The first stage is the full-band model and drive, the rest follow it inside the same oversampled pass
+    params.push_back(std::make_unique<juce::AudioParameterChoice>("chain stages", "Chain Stages", chainCounts, 0));
+    
+    for (int index = 0; index < StageParameters::maxChainStages - 1; ++index)
     {
-        postFilter = newValue;
+        const auto id = "stage " + juce::String(index + 2) + " ";
+        const auto name = "Stage " + juce::String(index + 2) + " ";
+        
+        params.push_back(std::make_unique<juce::AudioParameterChoice>(id + "model", name + "Model", disModels, 0));
+        params.push_back(std::make_unique<juce::AudioParameterFloat>(id + "drive", name + "Drive", 0.0, 24.0, 0.0));
+        params.push_back(std::make_unique<juce::AudioParameterFloat>(id + "tilt", name + "Tilt", -12.0, 12.0, 0.0));
     }
-    if (parameterID == "post cutoff")
+
+    return { params.begin(), params.end() };
+}
+
+void DistortionOversamplingAudioProcessor::parameterChanged(const juce::String &parameterID, float newValue)
+{
+    // called on whichever thread changed the parameter, so nothing here touches audio thread state
+    juce::ignoreUnused(parameterID, newValue);
+    requestTableRebuild();
+}
+
+void DistortionOversamplingAudioProcessor::requestTableRebuild()
+{
+    // works from the raw values, so it's safe from any thread. The table is only worth building while it is being used
+    const auto currentEngine = static_cast<Engine>(static_cast<int>(rawParameters.engine->load()));
+    
+    if (currentEngine == Engine::kTableLinear || currentEngine == Engine::kTableHermite)
+        waveshaperTable.requestRebuild(static_cast<int>(rawParameters.model->load()),
+                                       juce::Decibels::decibelsToGain(rawParameters.input->load()));
+}
+
+void DistortionOversamplingAudioProcessor::waitForTableIfOffline()
+{
+    // in real time the kernels stand in until the table is ready. Offline, that would make the output
+    // depend on thread timing, so the render waits for the table of the current model and drive instead
+    const auto currentEngine = static_cast<Engine>(static_cast<int>(rawParameters.engine->load()));
+
+    if (isNonRealtime() && (currentEngine == Engine::kTableLinear || currentEngine == Engine::kTableHermite))
+        waveshaperTable.waitUntilCurrent();
+}
+
+DistortionParameters DistortionOversamplingAudioProcessor::readParameters() const noexcept
+{
+    DistortionParameters snapshot;
+    
+    snapshot.oversample = rawParameters.oversample->load() >= 0.5f;
+    snapshot.osFactorIndex = juce::jlimit(0, DistortionStage<float>::numOversamplingFactors - 1, static_cast<int>(rawParameters.osFactor->load()));
+    snapshot.osFilterIndex = juce::jlimit(0, 1, static_cast<int>(rawParameters.osFilter->load()));
+    snapshot.autoOversample = rawParameters.osAuto->load() >= 0.5f;
+    snapshot.aliasThreshold = rawParameters.aliasThreshold->load();
+    snapshot.preFilter = rawParameters.preFilter->load() >= 0.5f;
+    snapshot.preCutoff = rawParameters.preCutoff->load();
+    snapshot.model = static_cast<DisModels>(juce::jlimit(0, 5, static_cast<int>(rawParameters.model->load())));
+    snapshot.drive = juce::Decibels::decibelsToGain(rawParameters.input->load());
+    snapshot.postFilter = rawParameters.postFilter->load() >= 0.5f;
+    snapshot.postCutoff = rawParameters.postCutoff->load();
+    snapshot.phase = rawParameters.phase->load() >= 0.5f;
+    snapshot.mix = rawParameters.mix->load();
+    snapshot.precision = static_cast<DistortionKernels::Precision>(juce::jlimit(0, 2, static_cast<int>(rawParameters.precision->load())));
+    snapshot.engine = static_cast<Engine>(juce::jlimit(0, 3, static_cast<int>(rawParameters.engine->load())));
+    snapshot.tonePlacement = static_cast<TonePlacement>(juce::jlimit(0, 2, static_cast<int>(rawParameters.tonePlacement->load())));
+    snapshot.numBands = juce::jlimit(1, DistortionParameters::maxBands, static_cast<int>(rawParameters.numBands->load()) + 1);
+    
+    // crossovers never cross, each one is at least as high as the one below
+    for (size_t crossover = 0; crossover < snapshot.crossovers.size(); ++crossover)
     {
-        postCutoff = newValue;
-        postLowPassFilter.setCutoffFrequency(postCutoff);
+        const auto frequency = rawParameters.crossovers[crossover]->load();
+        snapshot.crossovers[crossover] = crossover == 0 ? frequency : juce::jmax(frequency, snapshot.crossovers[crossover - 1]);
     }
-    if (parameterID == "phase")
+    
+    for (size_t band = 0; band < snapshot.bands.size(); ++band)
     {
-        phase = newValue;
+        const auto& raw = rawParameters.bands[band];
+        auto& settings = snapshot.bands[band];
+        settings.model = static_cast<DisModels>(juce::jlimit(0, 5, static_cast<int>(raw.model->load())));
+        settings.drive = juce::Decibels::decibelsToGain(raw.drive->load());
+        settings.mix = raw.mix->load();
+        settings.oversample = raw.oversample->load() >= 0.5f;
+        settings.bypass = raw.bypass->load() >= 0.5f;
     }
-    if (parameterID == "mix")
+    
+    snapshot.numChainStages = juce::jlimit(1, StageParameters::maxChainStages, static_cast<int>(rawParameters.numChainStages->load()) + 1);
+    
+    for (size_t index = 0; index < snapshot.chain.size(); ++index)
     {
-        mix = newValue;
+        const auto& raw = rawParameters.chain[index];
+        auto& settings = snapshot.chain[index];
+        settings.model = static_cast<DisModels>(juce::jlimit(0, 5, static_cast<int>(raw.model->load())));
+        settings.drive = juce::Decibels::decibelsToGain(raw.drive->load());
+        settings.tilt = raw.tilt->load();
     }
+    
+    return snapshot;
 }
 
 //==============================================================================
@@ -167,7 +287,7 @@ bool DistortionOversamplingAudioProcessor::isMidiEffect() const
 
 double DistortionOversamplingAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    return tailLengthSeconds.load();
 }
 
 int DistortionOversamplingAudioProcessor::getNumPrograms()
@@ -197,27 +317,33 @@ void DistortionOversamplingAudioProcessor::changeProgramName (int index, const j
 //==============================================================================
 void DistortionOversamplingAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
+    // hosts don't always keep to the block size they announce, so the engine is prepared for sub-blocks
+    // it can always be given: the announced size, capped so a sub-block's working set stays in cache
+    subBlockSize = juce::jlimit(1, maxSubBlockSize, samplesPerBlock);
+    
     juce::dsp::ProcessSpec spec;
     spec.sampleRate = sampleRate;
-    spec.maximumBlockSize = samplesPerBlock;
+    spec.maximumBlockSize = static_cast<juce::uint32>(subBlockSize);
     spec.numChannels = getTotalNumInputChannels();
     
-    osToggle = *treeState.getRawParameterValue("oversample");
-    oversamplingModule.initProcessing(samplesPerBlock);
-    preFilter = *treeState.getRawParameterValue("pre tone");
-    disModel = static_cast<DisModels>(treeState.getRawParameterValue("model")->load()); // not saving/recalling for some reason
-    rawInput = juce::Decibels::decibelsToGain(static_cast<float>(*treeState.getRawParameterValue("input"))); // drive
-    postFilter = *treeState.getRawParameterValue("post tone");
-    phase = *treeState.getRawParameterValue("phase");
-    mix = treeState.getRawParameterValue("mix")->load();
-    
-    preHighPassFilter.prepare(spec);
-    preHighPassFilter.setType(juce::dsp::LinkwitzRileyFilterType::highpass);
-    preHighPassFilter.setCutoffFrequency(treeState.getRawParameterValue("pre cutoff")->load());
-    
-    postLowPassFilter.prepare(spec);
-    postLowPassFilter.setType(juce::dsp::LinkwitzRileyFilterType::lowpass);
-    postLowPassFilter.setCutoffFrequency(treeState.getRawParameterValue("post cutoff")->load());
+    params = readParameters();
+    requestTableRebuild();
+    waitForTableIfOffline();
+    scopeFeed.prepare(sampleRate);
+    
+    // only the engine matching the host's precision is prepared, the other one never runs
+    if (isUsingDoublePrecision())
+    {
+        doubleEngine.prepare(spec, params);
+        setLatencySamples(doubleEngine.getLatencySamples());
+        tailLengthSeconds = doubleEngine.getTailLengthSeconds();
+    }
+    else
+    {
+        floatEngine.prepare(spec, params);
+        setLatencySamples(floatEngine.getLatencySamples());
+        tailLengthSeconds = floatEngine.getTailLengthSeconds();
+    }
 }
 
 void DistortionOversamplingAudioProcessor::releaseResources()
@@ -233,17 +359,16 @@ bool DistortionOversamplingAudioProcessor::isBusesLayoutSupported (const BusesLa
     juce::ignoreUnused (layouts);
     return true;
   #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    // Some plugin hosts, such as certain GarageBand versions, will only
-    // load plugins that support stereo bus layouts.
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
+    // Any layout up to maxNumChannels is fine, surround and immersive beds included, since
+    // every channel goes through the same chain. One instance can then cover a whole bed
+    const auto& mainOutput = layouts.getMainOutputChannelSet();
+    
+    if (mainOutput.isDisabled() || mainOutput.size() > maxNumChannels)
         return false;
 
     // This checks if the input layout matches the output layout
    #if ! JucePlugin_IsSynth
-    if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
+    if (mainOutput != layouts.getMainInputChannelSet())
         return false;
    #endif
 
@@ -253,6 +378,17 @@ bool DistortionOversamplingAudioProcessor::isBusesLayoutSupported (const BusesLa
 #endif
 
 void DistortionOversamplingAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+{
+    processBlockInternal(buffer, floatEngine);
+}
+
+void DistortionOversamplingAudioProcessor::processBlock (juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages)
+{
+    processBlockInternal(buffer, doubleEngine);
+}
+
+template <typename SampleType>
+void DistortionOversamplingAudioProcessor::processBlockInternal (juce::AudioBuffer<SampleType>& buffer, DistortionEngine<SampleType>& engine)
 {
     juce::ScopedNoDenormals noDenormals;
     auto totalNumInputChannels  = getTotalNumInputChannels();
@@ -261,182 +397,42 @@ void DistortionOversamplingAudioProcessor::processBlock (juce::AudioBuffer<float
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear (i, 0, buffer.getNumSamples());
     
-    juce::dsp::AudioBlock<float> block (buffer);
-    juce::dsp::AudioBlock<float> upSampledBlock (buffer);
+    // parameters are read once per block and only ever applied here, on the audio thread
+    params = readParameters();
+    waitForTableIfOffline();
     
-    // pre tone
-    if (preFilter)
-    {
-        preHighPassFilter.process(juce::dsp::ProcessContextReplacing<float>(block));
-    }
+    const auto measuring = instrumentation.isEnabled();
+    engine.setMeasuring(measuring);
+    
+    // the engine only ever sees sub-blocks up to the size it was prepared for, however much the host sends at once
+    juce::dsp::AudioBlock<SampleType> block (buffer);
+    const auto numSamples = block.getNumSamples();
     
-    // If statement of oversampling
-    if(osToggle)
+    for (size_t position = 0; position < numSamples; position += static_cast<size_t>(subBlockSize))
     {
-        // if on, increase sample rate
-        upSampledBlock = oversamplingModule.processSamplesUp(block);
+        auto subBlock = block.getSubBlock(position, juce::jmin(static_cast<size_t>(subBlockSize), numSamples - position));
+        const auto start = measuring ? juce::Time::getHighResolutionTicks() : 0;
         
-        // Distortion choice
-        for (int sample = 0; sample < upSampledBlock.getNumSamples(); ++sample)
-        {
-            for (int ch = 0; ch < upSampledBlock.getNumChannels(); ++ch)
-            {
-                float* data = upSampledBlock.getChannelPointer(ch);
-                
-                drySignal = data[sample]; // dry signal variable stored
-            
-                switch (disModel)
-                {
-                    case DisModels::kSoft: data[sample] = softClipData(data[sample]); break;
-                    case DisModels::kHard: data[sample] = hardClipData(data[sample]); break;
-                    case DisModels::kTube: data[sample] = tubeData(data[sample]); break;
-                    case DisModels::kHalfWave: data[sample] = halfWaveData(data[sample]); break;
-                    case DisModels::kFullWave: data[sample] = fullWaveData(data[sample]); break;
-                    case DisModels::kSine: data[sample] = sineData(data[sample]); break;
-                }
-                
-                blendSignal = (1.0 - mix.getNextValue()) * drySignal + mix.getNextValue() * data[sample]; // process for mixing signals based on mix parameter
-                data[sample] = blendSignal;
-                
-                //phase flip!
-                if (phase)
-                {
-                    data[sample] *= -1;
-                }
-            }
-        }
-        //decrease sample rate
-        oversamplingModule.processSamplesDown(block);
+        engine.process(subBlock, params);
         
-        // post tone
-        if (postFilter)
-        {
-            postLowPassFilter.process(juce::dsp::ProcessContextReplacing<float>(block));
-        }
-    }
-    
-    // if oversampling is off
-    else
-    {
-        // Distortion choice
-        for (int sample = 0; sample < block.getNumSamples(); ++sample)
+        if (measuring)
         {
-            for (int ch = 0; ch < block.getNumChannels(); ++ch)
-            {
-                float* data = block.getChannelPointer(ch);
-                
-                drySignal = data[sample]; // dry signal variable stored
-            
-                switch (disModel)
-                {
-                    case DisModels::kSoft: data[sample] = softClipData(data[sample]); break;
-                    case DisModels::kHard: data[sample] = hardClipData(data[sample]); break;
-                    case DisModels::kTube: data[sample] = tubeData(data[sample]); break;
-                    case DisModels::kHalfWave: data[sample] = halfWaveData(data[sample]); break;
-                    case DisModels::kFullWave: data[sample] = fullWaveData(data[sample]); break;
-                    case DisModels::kSine: data[sample] = sineData(data[sample]); break;
-                }
-                
-                blendSignal = (1.0 - mix.getNextValue()) * drySignal + mix.getNextValue() * data[sample]; // process for mixing signals based on mix parameter
-                data[sample] = blendSignal;
-                
-                //phase flip!
-                if (phase)
-                {
-                    data[sample] *= -1;
-                }
-            }
+            auto stats = engine.getBlockStats();
+            stats.totalTicks = juce::Time::getHighResolutionTicks() - start;
+            instrumentation.push(stats);
         }
         
-        // post tone
-        if (postFilter)
-        {
-            postLowPassFilter.process(juce::dsp::ProcessContextReplacing<float>(block));
-        }
-    }
-}
-
-// softclip algorithim (rounded)
-float DistortionOversamplingAudioProcessor::softClipData(float samples)
-{
-    samples *= rawInput * 6.0;
-    
-    return piDivisor * std::atan(samples);
-}
-
-// hardclip algorithim (any sample above 1 or -1 will be squared)
-float DistortionOversamplingAudioProcessor::hardClipData(float samples)
-{
-    samples *= rawInput;
-    
-    // will equate to true if the values is 1 or -1, because using absolute value
-    if (std::abs(samples) > 1.0)
-    {
-        // if true then this will output 1 (or -1)
-        samples *= 1.0 / std::abs(samples);
-    }
-    
-    return samples;
-}
-
-// tube algorithim (postive values will hardclip, negative values will softclip)
-float DistortionOversamplingAudioProcessor::tubeData(float samples)
-{
-    samples *= rawInput;
-//    samples += 0.1; // not including baising as it is causing off sets when no signal coming through...
-    
-    if (samples < 0.0)
-    {
-        samples = softClipData(samples);
-    }
-    else
-    {
-        samples = hardClipData(samples);
-    }
-    
-//    samples -= 0.1;
-    return softClipData(samples);
-}
-
-// half wave rectification (negative values are set to zero)
-float DistortionOversamplingAudioProcessor::halfWaveData(float samples)
-{
-    samples *= rawInput;
-    samples += 0.15; // biasing up
-    
-    if (samples < 0.0)
-    {
-        samples = 0.0;
+        scopeFeed.push(subBlock);
     }
     
-    samples -= 0.15; // biasing down
+    // the selected oversampling factor and filter set the latency, so keep host PDC in sync when they change
+    if (engine.getLatencySamples() != getLatencySamples())
+        setLatencySamples(engine.getLatencySamples());
     
-    return softClipData(samples); // softclipping on the positive part of wave
+    // the tail follows the tone filter settings
+    tailLengthSeconds = engine.getTailLengthSeconds();
 }
 
-// full wave retification (all negative values are mapped to corresponding positive values)
-float DistortionOversamplingAudioProcessor::fullWaveData(float samples)
-{
-    samples *= rawInput;
-    samples += 0.1; // biasing up
-    
-    if (samples < 0.0)
-    {
-        samples *= -1.0; // turns -1 values into positive. Could use absoluted here, but mulitplication is more processor efficient
-    }
-    
-    samples -= 0.1; // biasing down
-    
-    return softClipData(samples);
-}
-
-// sine/fold over clipping with limiting output (0.5)
-float DistortionOversamplingAudioProcessor::sineData(float samples)
-{
-    samples *= rawInput;
-    
-    return std::sin(0.5 * samples);
-}
 //==============================================================================
 bool DistortionOversamplingAudioProcessor::hasEditor() const
 {
@@ -445,8 +441,7 @@ bool DistortionOversamplingAudioProcessor::hasEditor() const
 
 juce::AudioProcessorEditor* DistortionOversamplingAudioProcessor::createEditor()
 {
-//    return new DistortionOversamplingAudioProcessorEditor (*this);
-    return new juce::GenericAudioProcessorEditor(*this);
+    return new DistortionOversamplingAudioProcessorEditor (*this);
 }
 
 //==============================================================================
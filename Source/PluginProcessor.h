@@ -9,6 +9,8 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "DistortionEngine.h"
+#include "ScopeFeed.h"
 
 //==============================================================================
 /**
@@ -29,6 +31,8 @@ public:
    #endif
 
     void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    void processBlock (juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+    bool supportsDoublePrecisionProcessing() const override    { return true; }
 
     //==============================================================================
     juce::AudioProcessorEditor* createEditor() override;
@@ -54,62 +58,95 @@ public:
     void setStateInformation (const void* data, int sizeInBytes) override;
     
     juce::AudioProcessorValueTreeState treeState;
-
-private:
     
-    juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
-    void parameterChanged (const juce::String& parameterID, float newValue) override;
+    // per-block timing and levels, for monitoring. Read it from one thread only, normally the message thread
+    Instrumentation& getInstrumentation() noexcept    { return instrumentation; }
     
-    // oversampling bool initialisation
-    bool osToggle {false};
+    // decimated output for the editor's scope
+    ScopeFeed& getScopeFeed() noexcept                { return scopeFeed; }
     
-    // oversampling dsp module initialisation
-    juce::dsp::Oversampling<float> oversamplingModule;
+    // widest supported layout, enough for 9.1.6 or third-order ambisonics
+    static constexpr int maxNumChannels = 16;
     
-    //variables
+    // longest run the engine processes in one go. Longer host blocks are split. At 16x oversampling
+    // a stereo float sub-block is 32 KB, which keeps each one in L2 from up-sampling to down-sampling
+    static constexpr int maxSubBlockSize = 256;
 
-    float preCutoff {20.0};
-    bool preFilter = false;
+private:
+    
+    juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
+    void parameterChanged (const juce::String& parameterID, float newValue) override;
     
-    float dBInput {0.0};
-    float rawInput {1.0};
+    // raw parameter values, looked up once in the constructor so the audio thread never searches by ID
+    struct RawParameters
+    {
+        std::atomic<float>* oversample = nullptr;
+        std::atomic<float>* osFactor = nullptr;
+        std::atomic<float>* osFilter = nullptr;
+        std::atomic<float>* osAuto = nullptr;
+        std::atomic<float>* aliasThreshold = nullptr;
+        std::atomic<float>* preFilter = nullptr;
+        std::atomic<float>* preCutoff = nullptr;
+        std::atomic<float>* model = nullptr;
+        std::atomic<float>* input = nullptr;
+        std::atomic<float>* postFilter = nullptr;
+        std::atomic<float>* postCutoff = nullptr;
+        std::atomic<float>* phase = nullptr;
+        std::atomic<float>* mix = nullptr;
+        std::atomic<float>* precision = nullptr;
+        std::atomic<float>* engine = nullptr;
+        std::atomic<float>* tonePlacement = nullptr;
+        std::atomic<float>* numBands = nullptr;
+        std::array<std::atomic<float>*, DistortionParameters::maxBands - 1> crossovers {};
+        
+        struct Band
+        {
+            std::atomic<float>* model = nullptr;
+            std::atomic<float>* drive = nullptr;
+            std::atomic<float>* mix = nullptr;
+            std::atomic<float>* oversample = nullptr;
+            std::atomic<float>* bypass = nullptr;
+        };
+        
+        std::array<Band, DistortionParameters::maxBands> bands;
+        
+        struct ChainStage
+        {
+            std::atomic<float>* model = nullptr;
+            std::atomic<float>* drive = nullptr;
+            std::atomic<float>* tilt = nullptr;
+        };
+        
+        std::atomic<float>* numChainStages = nullptr;
+        std::array<ChainStage, StageParameters::maxChainStages - 1> chain;
+    };
     
-    bool postFilter = false;
-    float postCutoff {1000.0};
+    RawParameters rawParameters;
     
-    bool phase = false;
+    // every parameter, read once at the top of each block. The audio thread works only from this copy
+    DistortionParameters readParameters() const noexcept;
+    DistortionParameters params;
     
-    float blendSignal {0.0f};
-    float drySignal {0.0f};
+    WaveshaperTable waveshaperTable;
+    void requestTableRebuild();
+    void waitForTableIfOffline();
     
-    juce::SmoothedValue<float> mix {0.0f};
+    // the whole signal path, once per sample type. Both share the table, which only depends on the parameters
+    DistortionEngine<float> floatEngine {waveshaperTable};
+    DistortionEngine<double> doubleEngine {waveshaperTable};
     
-    // distortion models enum selection
-    enum class DisModels
-    {
-        kSoft,
-        kHard,
-        kTube,
-        kHalfWave,
-        kFullWave,
-        kSine
-    };
+    Instrumentation instrumentation;
+    ScopeFeed scopeFeed;
     
-    DisModels disModel = DisModels::kSoft;
+    // what the engine was prepared for, and the most it's given at once
+    int subBlockSize {maxSubBlockSize};
     
-    //distortion
-    float softClipData(float samples);
-    float hardClipData(float samples);
-    float tubeData(float samples);
-    float halfWaveData(float samples);
-    float fullWaveData(float samples);
-    float sineData(float samples);
+    // written by the audio thread, read by the host from any thread
+    std::atomic<double> tailLengthSeconds {0.0};
     
-    // softclip divisor. Creating this constexpr is more efficient than doing 2/pi for every sample in the audio block, because calculated at initialisation
-    static constexpr float piDivisor = 2.0 / juce::MathConstants<float>::pi;
+    template <typename SampleType>
+    void processBlockInternal (juce::AudioBuffer<SampleType>& buffer, DistortionEngine<SampleType>& engine);
     
-    juce::dsp::LinkwitzRileyFilter<float> preHighPassFilter;
-    juce::dsp::LinkwitzRileyFilter<float> postLowPassFilter;
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DistortionOversamplingAudioProcessor)
 };
@@ -0,0 +1,70 @@
+/*
+  ==============================================================================
+
+    ScopeFeed.cpp
+
+  ==============================================================================
+*/
+
+#include "ScopeFeed.h"
+
+//==============================================================================
+void ScopeFeed::prepare (double sampleRate) noexcept
+{
+    groupSize = juce::jmax(1, juce::roundToInt(sampleRate / pointsPerSecond));
+    groupCount = 0;
+    group = {};
+}
+
+template <typename SampleType>
+void ScopeFeed::push (const juce::dsp::AudioBlock<SampleType>& block) noexcept
+{
+    if (numReaders.load(std::memory_order_relaxed) <= 0)
+        return;
+
+    const auto numSamples = block.getNumSamples();
+
+    for (size_t start = 0; start < numSamples;)
+    {
+        // the rest of the current group, or of the block if that comes first
+        const auto length = juce::jmin(static_cast<size_t>(groupSize - groupCount), numSamples - start);
+
+        for (size_t ch = 0; ch < block.getNumChannels(); ++ch)
+        {
+            const auto range = juce::FloatVectorOperations::findMinAndMax(block.getChannelPointer(ch) + start, static_cast<int>(length));
+            const auto low = static_cast<float>(range.getStart());
+            const auto high = static_cast<float>(range.getEnd());
+
+            // the first channel of a new group starts the range instead of extending the last one
+            group.min = (groupCount == 0 && ch == 0) ? low : juce::jmin(group.min, low);
+            group.max = (groupCount == 0 && ch == 0) ? high : juce::jmax(group.max, high);
+        }
+
+        groupCount += static_cast<int>(length);
+        start += length;
+
+        if (groupCount == groupSize)
+        {
+            const auto scope = fifo.write(1);
+
+            if (scope.blockSize1 > 0)
+                points[static_cast<size_t>(scope.startIndex1)] = group;
+
+            groupCount = 0;
+        }
+    }
+}
+
+int ScopeFeed::pull (Point* dest, int maxPoints) noexcept
+{
+    const auto scope = fifo.read(juce::jmin(maxPoints, fifo.getNumReady()));
+
+    std::copy_n(points.begin() + scope.startIndex1, scope.blockSize1, dest);
+    std::copy_n(points.begin() + scope.startIndex2, scope.blockSize2, dest + scope.blockSize1);
+
+    return scope.blockSize1 + scope.blockSize2;
+}
+
+//==============================================================================
+template void ScopeFeed::push<float> (const juce::dsp::AudioBlock<float>&) noexcept;
+template void ScopeFeed::push<double> (const juce::dsp::AudioBlock<double>&) noexcept;
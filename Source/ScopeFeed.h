@@ -0,0 +1,69 @@
+/*
+  ==============================================================================
+
+    ScopeFeed.h
+
+    Output snapshots for the editor's scope, passed from the audio thread to
+    the message thread through a single-producer single-consumer ring
+    buffer (an AbstractFifo).
+
+    The audio thread doesn't hand over raw audio. It keeps the minimum and
+    maximum of every group of samples, across all channels, and pushes one
+    point per group, about a thousand per second whatever the sample rate.
+    If the reader falls behind, points are dropped rather than waited for.
+    With no reader at all, push() returns after one atomic load, so a closed
+    editor costs the audio thread nothing.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+*/
+class ScopeFeed
+{
+public:
+    ScopeFeed() = default;
+
+    /** The range of the signal over one group of samples. */
+    struct Point
+    {
+        float min = 0.0f;
+        float max = 0.0f;
+    };
+
+    /** Sets the group size for this sample rate. Not while push() may be running. */
+    void prepare (double sampleRate) noexcept;
+
+    /** Audio thread. Wait-free; does nothing unless a reader is attached. */
+    template <typename SampleType>
+    void push (const juce::dsp::AudioBlock<SampleType>& block) noexcept;
+
+    /** Reader thread. Attaching starts the feed, detaching stops it again once no reader is left. */
+    void attachReader() noexcept    { ++numReaders; }
+    void detachReader() noexcept    { --numReaders; }
+
+    /** Reader thread. Copies up to maxPoints of the oldest points into dest and returns how many there were. */
+    int pull (Point* dest, int maxPoints) noexcept;
+
+    static constexpr double pointsPerSecond = 1000.0;
+    static constexpr int capacity = 4096;
+
+private:
+    //==============================================================================
+    juce::AbstractFifo fifo {capacity};
+    std::array<Point, capacity> points;
+    std::atomic<int> numReaders {0};
+
+    // the group being built, carried over from one block to the next
+    int groupSize {48};
+    int groupCount {0};
+    Point group;
+
+    //==============================================================================
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ScopeFeed)
+};
@@ -0,0 +1,102 @@
+/*
+  ==============================================================================
+
+    ScratchArena.h
+
+    One allocation holding every working buffer of an engine: dry copies,
+    band buffers, gain and drive ramps, filter fade buffers. Buffers are
+    handed out as AudioBlocks or plain arrays pointing into it, each one
+    starting on its own cache line.
+
+    The arena is laid out in two passes over the same code. In the first,
+    allocations only add up their sizes and return nothing usable. Then the
+    memory is allocated once, and the second pass hands out the real
+    pointers. Nothing is allocated after that until the next prepare, so the
+    audio thread never allocates, and the buffers of one engine sit next to
+    each other in memory.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+*/
+class ScratchArena
+{
+public:
+    ScratchArena() = default;
+
+    /** Starts the sizing pass. Blocks handed out before allocate() must not be used. */
+    void beginLayout() noexcept
+    {
+        measuring = true;
+        used = 0;
+    }
+
+    /** Allocates what the sizing pass added up, zeroed, and starts the pass that hands out the memory. */
+    void allocate()
+    {
+        size = used;
+        memory.allocate (size + alignment, true);
+        measuring = false;
+        used = 0;
+    }
+
+    /** An array of numElements, aligned to a cache line. */
+    template <typename Type>
+    Type* allocateArray (size_t numElements) noexcept
+    {
+        const auto offset = (used + alignment - 1) & ~(alignment - 1);
+        used = offset + numElements * sizeof (Type);
+
+        if (measuring)
+            return nullptr;
+
+        jassert (used <= size); // laid out differently in the two passes
+        return reinterpret_cast<Type*> (getAlignedStart() + offset);
+    }
+
+    /** A block of numChannels by numSamples, each channel aligned to a cache line. */
+    template <typename SampleType>
+    juce::dsp::AudioBlock<SampleType> allocateBlock (size_t numChannels, size_t numSamples) noexcept
+    {
+        auto** channels = allocateArray<SampleType*> (numChannels);
+
+        for (size_t ch = 0; ch < numChannels; ++ch)
+        {
+            auto* data = allocateArray<SampleType> (numSamples);
+
+            if (! measuring)
+                channels[ch] = data;
+        }
+
+        if (measuring)
+            return {};
+
+        return juce::dsp::AudioBlock<SampleType> (channels, numChannels, numSamples);
+    }
+
+    /** Total size in bytes, once allocated. */
+    size_t getSize() const noexcept    { return size; }
+
+    static constexpr size_t alignment = 64;
+
+private:
+    char* getAlignedStart() const noexcept
+    {
+        const auto address = reinterpret_cast<std::uintptr_t> (memory.get());
+        return memory.get() + (((address + alignment - 1) & ~(alignment - 1)) - address);
+    }
+
+    juce::HeapBlock<char> memory;
+    size_t size {0};
+    size_t used {0};
+    bool measuring {false};
+
+    //==============================================================================
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ScratchArena)
+};
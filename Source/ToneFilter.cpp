@@ -0,0 +1,209 @@
+/*
+  ==============================================================================
+
+    ToneFilter.cpp
+
+  ==============================================================================
+*/
+
+#include "ToneFilter.h"
+
+//==============================================================================
+template <typename SampleType>
+void ToneFilter<SampleType>::prepare (const juce::dsp::ProcessSpec& spec, Type newType, float newCutoff, bool enabled)
+{
+    type = newType;
+
+    // one entry per step from minCutoff up to maxCutoff, kept below Nyquist at low sample rates
+    const auto numEntries = static_cast<int>(std::ceil(std::log2(maxCutoff / minCutoff) * stepsPerOctave)) + 1;
+    cache.resize(static_cast<size_t>(numEntries));
+
+    for (int entry = 0; entry < numEntries; ++entry)
+    {
+        const auto frequency = juce::jmin(minCutoff * std::exp2(static_cast<double>(entry) / stepsPerOctave), 0.499 * spec.sampleRate);
+        const auto g = std::tan(juce::MathConstants<double>::pi * frequency / spec.sampleRate);
+
+        cache[static_cast<size_t>(entry)].g = static_cast<SampleType>(g);
+        cache[static_cast<size_t>(entry)].h = static_cast<SampleType>(1.0 / (1.0 + juce::MathConstants<double>::sqrt2 * g + g * g));
+    }
+
+    state.assign(spec.numChannels, {});
+
+    cutoff.reset(spec.sampleRate, 0.05);
+    cutoff.setCurrentAndTargetValue(juce::jlimit(minCutoff, maxCutoff, newCutoff));
+    enableGain.reset(spec.sampleRate, 0.01);
+    enableGain.setCurrentAndTargetValue(enabled ? 1 : 0);
+
+    cacheIndex = getCacheIndex(cutoff.getTargetValue());
+    coefficients = cache[static_cast<size_t>(cacheIndex)];
+}
+
+template <typename SampleType>
+void ToneFilter<SampleType>::setTarget (float newCutoff, bool enabled) noexcept
+{
+    cutoff.setTargetValue(juce::jlimit(minCutoff, maxCutoff, newCutoff));
+
+    const SampleType target = enabled ? 1 : 0;
+
+    if (target == enableGain.getTargetValue())
+        return;
+
+    // coming back on after fading all the way out, so whatever is left in the state is stale
+    if (enabled && ! enableGain.isSmoothing())
+        reset();
+
+    enableGain.setTargetValue(target);
+}
+
+template <typename SampleType>
+void ToneFilter<SampleType>::process (juce::dsp::AudioBlock<SampleType>& block) noexcept
+{
+    const auto numSamples = block.getNumSamples();
+
+    // off: the state is left as it is and only the cutoff keeps moving
+    if (! enableGain.isSmoothing() && enableGain.getTargetValue() == 0)
+    {
+        cutoff.skip(static_cast<int>(numSamples));
+        return;
+    }
+
+    if (! enableGain.isSmoothing())
+    {
+        processFiltered(block);
+        return;
+    }
+
+    // fading in or out, so blend with a copy of the unfiltered block
+    jassert(numSamples <= fadeScratch.getNumSamples() && block.getNumChannels() <= fadeScratch.getNumChannels());
+    auto dryBlock = fadeScratch.getSubsetChannelBlock(0, block.getNumChannels()).getSubBlock(0, numSamples);
+    dryBlock.copyFrom(block);
+    processFiltered(block);
+
+    for (size_t sample = 0; sample < numSamples; ++sample)
+    {
+        const auto gain = enableGain.getNextValue();
+
+        for (size_t ch = 0; ch < block.getNumChannels(); ++ch)
+        {
+            SampleType* data = block.getChannelPointer(ch);
+            const auto dry = dryBlock.getChannelPointer(ch)[sample];
+            data[sample] = dry + gain * (data[sample] - dry);
+        }
+    }
+}
+
+template <typename SampleType>
+void ToneFilter<SampleType>::skip() noexcept
+{
+    cutoff.setCurrentAndTargetValue(cutoff.getTargetValue());
+    enableGain.setCurrentAndTargetValue(enableGain.getTargetValue());
+}
+
+template <typename SampleType>
+void ToneFilter<SampleType>::reset() noexcept
+{
+    std::fill(state.begin(), state.end(), std::array<SampleType, 4> {});
+}
+
+//==============================================================================
+template <typename SampleType>
+int ToneFilter<SampleType>::getCacheIndex (float frequency) const noexcept
+{
+    const auto index = juce::roundToInt(std::log2(frequency / minCutoff) * stepsPerOctave);
+    return juce::jlimit(0, static_cast<int>(cache.size()) - 1, index);
+}
+
+template <typename SampleType>
+void ToneFilter<SampleType>::processFiltered (juce::dsp::AudioBlock<SampleType>& block) noexcept
+{
+    const auto numSamples = block.getNumSamples();
+    const auto numChannels = block.getNumChannels();
+
+    for (size_t start = 0; start < numSamples;)
+    {
+        // a still cutoff covers the rest of the block in one go
+        const auto length = cutoff.isSmoothing() ? juce::jmin(static_cast<size_t>(cutoffUpdateInterval), numSamples - start)
+                                                 : numSamples - start;
+
+        const auto index = getCacheIndex(cutoff.skip(static_cast<int>(length)));
+
+        if (index != cacheIndex)
+        {
+            cacheIndex = index;
+            coefficients = cache[static_cast<size_t>(index)];
+        }
+
+        size_t ch = 0;
+
+        for (; ch + 2 <= numChannels; ch += 2)
+        {
+            if (type == Type::kLowPass)
+                processLanes<2, true>(block, ch, start, length);
+            else
+                processLanes<2, false>(block, ch, start, length);
+        }
+
+        if (ch < numChannels)
+        {
+            if (type == Type::kLowPass)
+                processLanes<1, true>(block, ch, start, length);
+            else
+                processLanes<1, false>(block, ch, start, length);
+        }
+
+        start += length;
+    }
+}
+
+template <typename SampleType>
+template <int numLanes, bool isLowPass>
+void ToneFilter<SampleType>::processLanes (juce::dsp::AudioBlock<SampleType>& block, size_t firstChannel, size_t start, size_t length) noexcept
+{
+    const auto g = coefficients.g;
+    const auto h = coefficients.h;
+    const auto feedback = juce::MathConstants<SampleType>::sqrt2 + g;
+
+    // state and channel pointers held locally, so the lanes can stay in registers across the loop.
+    // The lanes are independent, which lets their recursions overlap; any vectorising is up to the compiler
+    SampleType* data[numLanes];
+    SampleType s1[numLanes], s2[numLanes], s3[numLanes], s4[numLanes];
+
+    for (int lane = 0; lane < numLanes; ++lane)
+    {
+        const auto& channelState = state[firstChannel + static_cast<size_t>(lane)];
+        data[lane] = block.getChannelPointer(firstChannel + static_cast<size_t>(lane));
+        s1[lane] = channelState[0];
+        s2[lane] = channelState[1];
+        s3[lane] = channelState[2];
+        s4[lane] = channelState[3];
+    }
+
+    for (auto sample = start; sample < start + length; ++sample)
+    {
+        for (int lane = 0; lane < numLanes; ++lane)
+        {
+            // first section
+            const auto yH = (data[lane][sample] - feedback * s1[lane] - s2[lane]) * h;
+            const auto yB = g * yH + s1[lane];
+            s1[lane] = g * yH + yB;
+            const auto yL = g * yB + s2[lane];
+            s2[lane] = g * yB + yL;
+
+            // second section, fed from the same output so the two make 24 dB/oct
+            const auto yH2 = ((isLowPass ? yL : yH) - feedback * s3[lane] - s4[lane]) * h;
+            const auto yB2 = g * yH2 + s3[lane];
+            s3[lane] = g * yH2 + yB2;
+            const auto yL2 = g * yB2 + s4[lane];
+            s4[lane] = g * yB2 + yL2;
+
+            data[lane][sample] = isLowPass ? yL2 : yH2;
+        }
+    }
+
+    for (int lane = 0; lane < numLanes; ++lane)
+        state[firstChannel + static_cast<size_t>(lane)] = { s1[lane], s2[lane], s3[lane], s4[lane] };
+}
+
+//==============================================================================
+template class ToneFilter<float>;
+template class ToneFilter<double>;
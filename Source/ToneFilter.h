@@ -0,0 +1,121 @@
+/*
+  ==============================================================================
+
+    ToneFilter.h
+
+    The pre and post tone filters: a 24 dB/oct Linkwitz-Riley high or low
+    pass, built the same way as juce::dsp::LinkwitzRileyFilter (two
+    cascaded TPT state variable sections), with a few differences for the
+    audio thread.
+
+    Coefficients come from a cache filled in prepare(), one entry every
+    1/128 octave across the cutoff range. A moving cutoff only swaps
+    coefficients when it lands on a new entry, so automation never calls
+    tan(). Snapping to the grid moves the cutoff by 0.3% at most.
+
+    Channels are processed in pairs, each pair in lock step through one
+    loop. The two recursions don't depend on each other, so the CPU can
+    overlap them instead of waiting on one chain of multiplies at a time.
+    This is plain scalar code: the compiler may pack the pair into one
+    SIMD register, but nothing here makes it.
+
+    Switching the filter off stops processing it altogether. Switching it
+    back on clears its state and fades it in, so nothing stale or abrupt
+    is heard. The fade needs a copy of the unfiltered block, in scratch
+    memory lent by the owner. It's only used inside process(), so filters
+    that run one after the other can share it.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+*/
+template <typename SampleType>
+class ToneFilter
+{
+public:
+    enum class Type
+    {
+        kLowPass,
+        kHighPass
+    };
+
+    ToneFilter() = default;
+
+    /** Builds the coefficient cache for this sample rate and starts at the given settings without ramping. */
+    void prepare (const juce::dsp::ProcessSpec& spec, Type type, float cutoff, bool enabled);
+
+    /** Sets where the cutoff and the on/off fade should head over the next blocks. */
+    void setTarget (float cutoff, bool enabled) noexcept;
+
+    /** Filters a block in place, following the cutoff and fading in or out. */
+    void process (juce::dsp::AudioBlock<SampleType>& block) noexcept;
+
+    /** Jumps straight to the targets, for blocks that aren't processed at all. */
+    void skip() noexcept;
+
+    /** Clears the filter state. */
+    void reset() noexcept;
+
+    /** Space for the unfiltered copy while fading, at least as long as the longest block and as wide as the spec. */
+    void setFadeScratch (juce::dsp::AudioBlock<SampleType> scratch) noexcept    { fadeScratch = scratch; }
+
+    bool isEnabled() const noexcept    { return enableGain.getTargetValue() > 0; }
+
+    /** True while the filter is on or still fading out, so process() does something. */
+    bool isActive() const noexcept     { return enableGain.isSmoothing() || isEnabled(); }
+
+    /** How long a Linkwitz-Riley filter at this cutoff takes to ring down by 120 dB, for working out tails. */
+    static double getRingSeconds (float cutoff) noexcept
+    {
+        // about 1.5 / (zeta * 2 pi fc) per 13.8 time constants, which is 120 dB
+        constexpr double zeta = 0.70710678118654752;
+        constexpr double ringTimeConstants = 1.5 * 13.8;
+        return ringTimeConstants / (zeta * juce::MathConstants<double>::twoPi * juce::jmax (1.0f, cutoff));
+    }
+
+    static constexpr float minCutoff = 20.0f;
+    static constexpr float maxCutoff = 20000.0f;
+    static constexpr int stepsPerOctave = 128;
+
+private:
+    //==============================================================================
+    struct Coefficients
+    {
+        SampleType g = 0; // tan(pi fc / fs)
+        SampleType h = 0; // 1 / (1 + R2 g + g^2)
+    };
+
+    // the cache entry for a cutoff, rounded to the nearest step
+    int getCacheIndex (float cutoff) const noexcept;
+
+    // filters numLanes channels from firstChannel, over samples [start, start + length)
+    template <int numLanes, bool isLowPass>
+    void processLanes (juce::dsp::AudioBlock<SampleType>& block, size_t firstChannel, size_t start, size_t length) noexcept;
+    void processFiltered (juce::dsp::AudioBlock<SampleType>& block) noexcept;
+
+    //==============================================================================
+    Type type {Type::kLowPass};
+    std::vector<Coefficients> cache;
+    Coefficients coefficients;
+    int cacheIndex {-1};
+
+    // two TPT sections per channel, two integrator states each
+    std::vector<std::array<SampleType, 4>> state;
+
+    // the cutoff is log-smoothed, and the cache is looked up again every cutoffUpdateInterval samples while it moves
+    juce::SmoothedValue<SampleType, juce::ValueSmoothingTypes::Multiplicative> cutoff {1000};
+    juce::SmoothedValue<SampleType> enableGain {0};
+    static constexpr int cutoffUpdateInterval = 16;
+
+    // unfiltered copy, for fading the filter in and out
+    juce::dsp::AudioBlock<SampleType> fadeScratch;
+
+    //==============================================================================
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ToneFilter)
+};
@@ -0,0 +1,125 @@
+/*
+  ==============================================================================
+
+    WaveshaperTable.cpp
+
+  ==============================================================================
+*/
+
+#include "WaveshaperTable.h"
+
+//==============================================================================
+WaveshaperTable::WaveshaperTable()
+    : juce::Thread ("Waveshaper table builder")
+{
+    // all the memory is allocated here, so rebuilding never allocates
+    for (auto& table : tables)
+        table.values.resize(numPoints, 0.0f);
+
+    startThread();
+}
+
+WaveshaperTable::~WaveshaperTable()
+{
+    stopThread(1000);
+}
+
+void WaveshaperTable::requestRebuild (int modelIndex, float drive)
+{
+    requestedDrive = drive;
+    requestedModel = modelIndex;
+    notify();
+}
+
+void WaveshaperTable::waitUntilCurrent()
+{
+    while (requestedModel.load() >= 0 && (builtModel.load() != requestedModel.load() || builtDrive.load() != requestedDrive.load()))
+        tableBuilt.wait(-1);
+}
+
+bool WaveshaperTable::acquireLatest (int modelIndex, float drive) noexcept
+{
+    if (middleIndex.load() & freshBit)
+        frontIndex = middleIndex.exchange(frontIndex) & ~freshBit;
+
+    const auto& table = tables[static_cast<size_t>(frontIndex)];
+    return table.model == modelIndex && table.drive == drive;
+}
+
+template <typename SampleType>
+void WaveshaperTable::process (SampleType* data, int numSamples, Interpolation interpolation) const noexcept
+{
+    const auto& table = tables[static_cast<size_t>(frontIndex)];
+    const float* values = table.values.data();
+    const auto exactKernel = DistortionKernels::getReferenceKernel<SampleType>(table.model);
+    constexpr SampleType scale = SampleType(1) / step;
+
+    for (int sample = 0; sample < numSamples; ++sample)
+    {
+        const SampleType x = data[sample];
+
+        // outside the table (or NaN), so fall back to the exact curve
+        if (! (std::abs(x) < inputRange))
+        {
+            exactKernel(data + sample, 1, static_cast<SampleType>(table.drive));
+            continue;
+        }
+
+        const SampleType position = (x + inputRange) * scale;
+        const int index = juce::jmin(static_cast<int>(position), tableSize - 1);
+        const SampleType frac = position - static_cast<SampleType>(index);
+
+        // values[index + 1] is the grid point at or below x, because of the guard point
+        const float* y = values + index;
+
+        if (interpolation == Interpolation::kLinear)
+        {
+            data[sample] = y[1] + frac * (y[2] - y[1]);
+        }
+        else
+        {
+            // cubic Hermite (Catmull-Rom) through the four surrounding points
+            const SampleType c1 = 0.5f * (y[2] - y[0]);
+            const SampleType c2 = y[0] - 2.5f * y[1] + 2.0f * y[2] - 0.5f * y[3];
+            const SampleType c3 = 0.5f * (y[3] - y[0]) + 1.5f * (y[1] - y[2]);
+
+            data[sample] = ((c3 * frac + c2) * frac + c1) * frac + y[1];
+        }
+    }
+}
+
+template void WaveshaperTable::process<float> (float*, int, Interpolation) const noexcept;
+template void WaveshaperTable::process<double> (double*, int, Interpolation) const noexcept;
+
+//==============================================================================
+void WaveshaperTable::run()
+{
+    while (! threadShouldExit())
+    {
+        const int model = requestedModel.load();
+        const float drive = requestedDrive.load();
+
+        if (model >= 0 && (model != builtModel || drive != builtDrive))
+        {
+            auto& table = tables[static_cast<size_t>(backIndex)];
+            table.model = model;
+            table.drive = drive;
+
+            // sample the grid, then shape it in place with the exact kernel
+            for (int point = 0; point < numPoints; ++point)
+                table.values[static_cast<size_t>(point)] = -inputRange + static_cast<float>(point - 1) * step;
+
+            DistortionKernels::getReferenceKernel<float>(model)(table.values.data(), numPoints, drive);
+
+            // hand the finished table over and take back whichever one was waiting
+            backIndex = middleIndex.exchange(backIndex | freshBit) & ~freshBit;
+
+            builtDrive = drive;
+            builtModel = model;
+            tableBuilt.signal();
+            continue; // a newer request may have arrived while building
+        }
+
+        wait(-1);
+    }
+}
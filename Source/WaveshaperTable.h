@@ -0,0 +1,97 @@
+/*
+  ==============================================================================
+
+    WaveshaperTable.h
+
+    Lookup-table alternative to the block kernels. The current model's transfer
+    curve (drive included) is sampled into an interpolated table on a
+    background thread whenever the model or drive changes, and handed to the
+    audio thread through a lock-free triple buffer. The audio thread only ever
+    reads finished tables, so its cost per sample is the same for every model.
+    Until a table is ready the exact kernels run instead, so offline renders
+    wait for it rather than depend on thread timing.
+
+    The grid step is 1/1024, so curves that turn faster than that (tube and
+    the rectifiers at high drive) are only as accurate as the interpolation
+    between neighbouring points. Use the Direct engine where that matters.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "DistortionKernels.h"
+
+//==============================================================================
+/**
+*/
+class WaveshaperTable  : private juce::Thread
+{
+public:
+    enum class Interpolation
+    {
+        kLinear,
+        kHermite
+    };
+
+    WaveshaperTable();
+    ~WaveshaperTable() override;
+
+    /** Asks the builder thread for a table of this model and drive. Cheap, and safe to call from any thread. */
+    void requestRebuild (int modelIndex, float drive);
+
+    /** Blocks until the table for the latest request has been handed over. For offline rendering, where
+        the output mustn't depend on how soon the builder thread gets to run. Never call it in real time.
+    */
+    void waitUntilCurrent();
+
+    /** Picks up the newest finished table, if there is one. Call once per block on the audio thread.
+        Returns false unless the table is for this model and drive, so a stale one is never heard
+        while the builder catches up with a change.
+    */
+    bool acquireLatest (int modelIndex, float drive) noexcept;
+
+    /** Shapes one channel in place through the table picked up by acquireLatest(), once it has returned true.
+        Samples outside the table's input range go through the exact kernel instead.
+        The table itself is always float; double buffers are interpolated in double.
+    */
+    template <typename SampleType>
+    void process (SampleType* data, int numSamples, Interpolation interpolation) const noexcept;
+
+    // input range covered by the table, and the number of intervals across it
+    static constexpr float inputRange = 4.0f;
+    static constexpr int tableSize = 8192;
+
+private:
+    void run() override;
+
+    struct Table
+    {
+        std::vector<float> values;
+        int model = -1; // -1 until the first table is built
+        float drive = 1.0f;
+    };
+
+    // one guard point below the range and two above, for the Hermite neighbours
+    static constexpr int numPoints = tableSize + 3;
+    static constexpr float step = 2.0f * inputRange / static_cast<float> (tableSize);
+
+    // triple buffer: the audio thread owns front, the builder owns back, and finished tables pass through middle
+    std::array<Table, 3> tables;
+    int frontIndex = 0;
+    int backIndex = 1;
+    std::atomic<int> middleIndex {2};
+    static constexpr int freshBit = 4;
+
+    std::atomic<int> requestedModel {-1};
+    std::atomic<float> requestedDrive {1.0f};
+
+    // what the newest handed-over table was built for, signalled each time one is
+    std::atomic<int> builtModel {-1};
+    std::atomic<float> builtDrive {0.0f};
+    juce::WaitableEvent tableBuilt;
+
+    //==============================================================================
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (WaveshaperTable)
+};
@@ -0,0 +1,590 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    DistortionAnalysis
+
+    What each configuration costs, and what it buys. Every model is run
+    with every shaping engine and precision, with oversampling off, at each
+    factor and in the automatic mode. Each one is fed pure sines at a few
+    frequencies and drive levels, and the output spectrum is split into:
+
+      - the fundamental,
+      - its harmonics, which a distortion is meant to make,
+      - everything else, which for a pure tone in is aliasing (plus the
+        float noise floor, far below it),
+      - and DC.
+
+    The tones sit exactly on FFT bins, so the window is rectangular and no
+    bin leaks into its neighbours. Each configuration's worst case across
+    the tones and drives goes next to its measured cost in ns per sample,
+    and the table marks the ones no other configuration of the same model
+    beats on both.
+
+    --max-aliasing picks the cheapest configuration of each model that stays
+    under a level. --baseline compares against an earlier --output and
+    fails if any configuration got worse by more than --tolerance dB, so a
+    speed-up can't quietly cost quality.
+
+      DistortionAnalysis [--output results.json] [--quick] [--fir]
+                         [--sample-rate 48000] [--seconds 0.5]
+                         [--max-aliasing -90] [--alias-threshold -90]
+                         [--baseline old.json] [--tolerance 1]
+                         [--set "id=value"]...
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+#include "../Shared/ToolHelpers.h"
+
+namespace
+{
+    const juce::StringArray modelNames = {"Soft", "Hard", "Tube", "Half-Wave", "Full-Wave", "Sine"};
+    const juce::StringArray precisionNames = {"Exact", "High", "Eco"};
+    const juce::StringArray engineNames = {"Direct", "Linear", "Hermite", "ADAA"};
+    const juce::StringArray factorNames = {"2x", "4x", "8x", "16x"};
+    const juce::StringArray filterNames = {"IIR", "FIR"};
+
+    constexpr int fftOrder = 14;
+    constexpr int fftSize = 1 << fftOrder;
+    constexpr int blockSize = 512;
+    constexpr float toneAmplitude = 0.5f;
+    constexpr int autoOversampling = 4;
+
+    struct Settings
+    {
+        double sampleRate = 48000.0;
+        double seconds = 0.5;
+        int repetitions = 3;
+        bool quick = false;
+        bool includeFIR = false;
+        float aliasThreshold = -90.0f;
+        juce::StringArray extraParameters;
+    };
+
+    void setParameter (DistortionOversamplingAudioProcessor& processor, const juce::String& id, float value)
+    {
+        const auto result = ToolHelpers::applyParameter(processor.treeState, id + "=" + juce::String(value));
+
+        if (result.failed())
+            juce::ConsoleApplication::fail(result.getErrorMessage());
+    }
+
+    double toDecibels (double power)
+    {
+        return power > 0.0 ? juce::jmax(-200.0, 10.0 * std::log10(power)) : -200.0;
+    }
+
+    //==============================================================================
+    struct Config
+    {
+        int model;
+        int oversampling; // -1 is off, 0 to 3 the factor index, 4 automatic up to 16x
+        int filter;
+        int engine;
+        int precision;
+
+        juce::String getOversamplingName() const
+        {
+            if (oversampling < 0)
+                return "off";
+
+            return (oversampling == autoOversampling ? juce::String("auto") : factorNames[oversampling]) + " " + filterNames[filter];
+        }
+
+        juce::String getShaperName() const
+        {
+            return engine == 0 ? engineNames[engine] + " " + precisionNames[precision] : engineNames[engine];
+        }
+
+        juce::String getName() const
+        {
+            return modelNames[model] + "/os:" + getOversamplingName() + "/shaper:" + getShaperName();
+        }
+
+        void apply (DistortionOversamplingAudioProcessor& processor, const Settings& settings) const
+        {
+            setParameter(processor, "model", static_cast<float>(model));
+            setParameter(processor, "engine", static_cast<float>(engine));
+            setParameter(processor, "precision", static_cast<float>(precision));
+            setParameter(processor, "oversample", oversampling >= 0 ? 1.0f : 0.0f);
+            setParameter(processor, "os factor", static_cast<float>(juce::jlimit(0, 3, oversampling)));
+            setParameter(processor, "os filter", static_cast<float>(filter));
+            setParameter(processor, "os auto", oversampling == autoOversampling ? 1.0f : 0.0f);
+            setParameter(processor, "alias threshold", settings.aliasThreshold);
+
+            // --set goes last, so it can pin anything the sweep doesn't cover (tone filters, chain stages)
+            for (const auto& assignment : settings.extraParameters)
+            {
+                const auto result = ToolHelpers::applyParameter(processor.treeState, assignment);
+
+                if (result.failed())
+                    juce::ConsoleApplication::fail(result.getErrorMessage());
+            }
+        }
+    };
+
+    //==============================================================================
+    struct ToneResult
+    {
+        double frequency = 0.0;
+        float driveDecibels = 0.0f;
+        double fundamental = 0.0; // dBFS
+        double harmonics = 0.0;   // dBFS, the sum of every in-band harmonic
+        double aliasing = 0.0;    // dBFS, the sum of every bin that isn't a harmonic or DC
+        double thdN = 0.0;        // dB relative to the fundamental
+        double dcOffset = 0.0;
+
+        juce::var toVar() const
+        {
+            auto* result = new juce::DynamicObject();
+            result->setProperty("frequency", frequency);
+            result->setProperty("drive_db", driveDecibels);
+            result->setProperty("fundamental_dbfs", fundamental);
+            result->setProperty("harmonics_dbfs", harmonics);
+            result->setProperty("aliasing_dbfs", aliasing);
+            result->setProperty("aliasing_dbc", aliasing - fundamental);
+            result->setProperty("thd_n_db", thdN);
+            result->setProperty("dc_offset", dcOffset);
+            return juce::var(result);
+        }
+    };
+
+    /** The output of the last fftSize samples, split up by bin. The tone is on bin toneBin. */
+    ToneResult analyse (const float* output, int toneBin)
+    {
+        ToneResult result;
+
+        double sum = 0.0;
+
+        for (int i = 0; i < fftSize; ++i)
+            sum += output[i];
+
+        result.dcOffset = sum / fftSize;
+
+        std::vector<float> spectrum (2 * fftSize, 0.0f);
+        std::copy(output, output + fftSize, spectrum.begin());
+
+        juce::dsp::FFT fft (fftOrder);
+        fft.performFrequencyOnlyForwardTransform(spectrum.data());
+
+        // squared amplitude of each bin, so a full scale sine comes out as 1 (0 dBFS)
+        double fundamental = 0.0, harmonics = 0.0, other = 0.0;
+
+        for (int bin = 1; bin < fftSize / 2; ++bin)
+        {
+            const auto amplitude = 2.0 * spectrum[static_cast<size_t>(bin)] / fftSize;
+            const auto power = amplitude * amplitude;
+
+            if (bin == toneBin)
+                fundamental += power;
+            else if (bin % toneBin == 0)
+                harmonics += power;
+            else
+                other += power;
+        }
+
+        result.fundamental = toDecibels(fundamental);
+        result.harmonics = toDecibels(harmonics);
+        result.aliasing = toDecibels(other);
+        result.thdN = fundamental > 0.0 ? toDecibels((harmonics + other) / fundamental) : 0.0;
+        return result;
+    }
+
+    /** Runs a sine on an exact bin through the processor, and analyses the output once it has settled. */
+    ToneResult measureTone (DistortionOversamplingAudioProcessor& processor, const Settings& settings, double frequency, float driveDecibels)
+    {
+        setParameter(processor, "input", driveDecibels);
+
+        // an odd bin shares no factor with the FFT size, so folded harmonics land between the harmonics' bins
+        auto toneBin = juce::jlimit(1, fftSize / 2 - 1, juce::roundToInt(frequency * fftSize / settings.sampleRate));
+        toneBin |= 1;
+
+        // past the latency, the drive smoothing and the automatic mode's step-down hold
+        const auto settleSamples = processor.getLatencySamples() + static_cast<int>(0.5 * settings.sampleRate);
+        const auto numBlocks = (settleSamples + fftSize + blockSize - 1) / blockSize;
+
+        std::vector<float> output (static_cast<size_t>(numBlocks * blockSize));
+        juce::AudioBuffer<float> buffer (1, blockSize);
+        juce::MidiBuffer midi;
+
+        for (int block = 0; block < numBlocks; ++block)
+        {
+            float* data = buffer.getWritePointer(0);
+
+            for (int i = 0; i < blockSize; ++i)
+            {
+                // the phase wraps every fftSize samples, so the capture is exactly periodic
+                const auto phase = static_cast<double>((static_cast<juce::int64>(block * blockSize + i) * toneBin) % fftSize) / fftSize;
+                data[i] = toneAmplitude * static_cast<float>(std::sin(juce::MathConstants<double>::twoPi * phase));
+            }
+
+            processor.processBlock(buffer, midi);
+            std::copy(data, data + blockSize, output.begin() + block * blockSize);
+        }
+
+        auto result = analyse(output.data() + output.size() - fftSize, toneBin);
+        result.frequency = toneBin * settings.sampleRate / fftSize;
+        result.driveDecibels = driveDecibels;
+        return result;
+    }
+
+    /** Median ns per sample for processBlock on the shared test signal, in mono at the analysis block size. */
+    double measureCost (DistortionOversamplingAudioProcessor& processor, const Settings& settings, const juce::AudioBuffer<float>& source)
+    {
+        setParameter(processor, "input", 12.0f);
+
+        juce::AudioBuffer<float> buffer (1, blockSize);
+        juce::MidiBuffer midi;
+
+        const auto blocksPerRun = juce::jmax(1, static_cast<int>(settings.seconds * settings.sampleRate) / blockSize);
+        const auto sourceBlocks = source.getNumSamples() / blockSize;
+        int sourceBlock = 0;
+
+        auto runBlocks = [&] (int numBlocks)
+        {
+            juce::int64 ticks = 0;
+
+            for (int i = 0; i < numBlocks; ++i)
+            {
+                buffer.copyFrom(0, 0, source, 0, sourceBlock * blockSize, blockSize);
+                sourceBlock = (sourceBlock + 1) % sourceBlocks;
+
+                const auto start = juce::Time::getHighResolutionTicks();
+                processor.processBlock(buffer, midi);
+                ticks += juce::Time::getHighResolutionTicks() - start;
+            }
+
+            return juce::Time::highResolutionTicksToSeconds(ticks);
+        };
+
+        runBlocks(juce::jmax(1, blocksPerRun / 10));
+
+        std::vector<double> runs;
+
+        for (int i = 0; i < settings.repetitions; ++i)
+            runs.push_back(runBlocks(blocksPerRun));
+
+        std::sort(runs.begin(), runs.end());
+        return runs[runs.size() / 2] * 1.0e9 / (static_cast<double>(blocksPerRun) * blockSize);
+    }
+
+    //==============================================================================
+    struct ConfigResult
+    {
+        Config config;
+        int latency = 0;
+        double nsPerSample = 0.0;
+        double worstAliasing = -200.0; // dBFS
+        double worstThdN = -200.0;     // dB
+        double worstDcOffset = 0.0;
+        bool pareto = false;
+        std::vector<ToneResult> tones;
+
+        juce::var toVar() const
+        {
+            auto toneResults = juce::var::emptyArray();
+
+            for (const auto& tone : tones)
+                toneResults.append(tone.toVar());
+
+            auto* result = new juce::DynamicObject();
+            result->setProperty("name", config.getName());
+            result->setProperty("model", modelNames[config.model]);
+            result->setProperty("oversampling", config.getOversamplingName());
+            result->setProperty("shaper", config.getShaperName());
+            result->setProperty("latency_samples", latency);
+            result->setProperty("ns_per_sample", nsPerSample);
+            result->setProperty("worst_aliasing_dbfs", worstAliasing);
+            result->setProperty("worst_thd_n_db", worstThdN);
+            result->setProperty("worst_dc_offset", worstDcOffset);
+            result->setProperty("pareto", pareto);
+            result->setProperty("tones", toneResults);
+            return juce::var(result);
+        }
+    };
+
+    ConfigResult runConfig (const Config& config, const Settings& settings, const juce::AudioBuffer<float>& source)
+    {
+        DistortionOversamplingAudioProcessor processor;
+        config.apply(processor, settings);
+
+        const auto prepared = ToolHelpers::prepareProcessor(processor, settings.sampleRate, blockSize, 1, true);
+
+        if (prepared.failed())
+            juce::ConsoleApplication::fail(prepared.getErrorMessage());
+
+        ConfigResult result;
+        result.config = config;
+
+        // low, presence and top octave tones; the higher the tone, the sooner its harmonics fold
+        const std::vector<double> frequencies = settings.quick ? std::vector<double> { 1000.0, 8000.0 }
+                                                               : std::vector<double> { 100.0, 1000.0, 5000.0, 12000.0 };
+        const std::vector<float> drives = settings.quick ? std::vector<float> { 6.0f, 24.0f }
+                                                         : std::vector<float> { 0.0f, 12.0f, 24.0f };
+
+        for (auto frequency : frequencies)
+        {
+            if (frequency >= 0.45 * settings.sampleRate)
+                continue;
+
+            for (auto drive : drives)
+            {
+                const auto tone = measureTone(processor, settings, frequency, drive);
+                result.worstAliasing = juce::jmax(result.worstAliasing, tone.aliasing);
+                result.worstThdN = juce::jmax(result.worstThdN, tone.thdN);
+                result.worstDcOffset = juce::jmax(result.worstDcOffset, std::abs(tone.dcOffset));
+                result.tones.push_back(tone);
+            }
+        }
+
+        // the automatic mode's latency follows the largest factor, which it reports from the start
+        result.latency = processor.getLatencySamples();
+        result.nsPerSample = measureCost(processor, settings, source);
+
+        processor.releaseResources();
+        return result;
+    }
+
+    /** Marks each configuration that no other of the same model beats on both cost and aliasing. */
+    void markParetoFront (std::vector<ConfigResult>& results)
+    {
+        for (auto& candidate : results)
+        {
+            candidate.pareto = std::none_of(results.begin(), results.end(), [&] (const ConfigResult& other)
+            {
+                return other.config.model == candidate.config.model
+                    && other.nsPerSample <= candidate.nsPerSample
+                    && other.worstAliasing <= candidate.worstAliasing
+                    && (other.nsPerSample < candidate.nsPerSample || other.worstAliasing < candidate.worstAliasing);
+            });
+        }
+    }
+
+    //==============================================================================
+    void printTable (const std::vector<ConfigResult>& results)
+    {
+        auto column = [] (const juce::String& text, int width)
+        {
+            return text.paddedRight(' ', width);
+        };
+
+        auto decibels = [] (double value)
+        {
+            return juce::String(value, 1);
+        };
+
+        std::cout << column("model", 11) << column("oversampling", 14) << column("shaper", 14)
+                  << column("ns/sample", 11) << column("aliasing", 10) << column("thd+n", 9)
+                  << column("dc", 11) << column("latency", 9) << "pareto" << std::endl;
+
+        for (int model = 0; model < modelNames.size(); ++model)
+        {
+            std::vector<const ConfigResult*> rows;
+
+            for (const auto& result : results)
+                if (result.config.model == model)
+                    rows.push_back(&result);
+
+            std::sort(rows.begin(), rows.end(), [] (const ConfigResult* a, const ConfigResult* b)
+            {
+                return a->nsPerSample < b->nsPerSample;
+            });
+
+            for (const auto* row : rows)
+            {
+                std::cout << column(modelNames[model], 11)
+                          << column(row->config.getOversamplingName(), 14)
+                          << column(row->config.getShaperName(), 14)
+                          << column(juce::String(row->nsPerSample, 2), 11)
+                          << column(decibels(row->worstAliasing), 10)
+                          << column(decibels(row->worstThdN), 9)
+                          << column(juce::String(row->worstDcOffset, 6), 11)
+                          << column(juce::String(row->latency), 9)
+                          << (row->pareto ? "*" : "") << std::endl;
+            }
+
+            std::cout << std::endl;
+        }
+    }
+
+    /** The cheapest configuration of each model whose worst aliasing stays at or under the target. */
+    juce::var chooseCheapest (const std::vector<ConfigResult>& results, double maxAliasing)
+    {
+        auto choices = juce::var::emptyArray();
+
+        std::cout << "cheapest with aliasing at or under " << maxAliasing << " dBFS:" << std::endl;
+
+        for (int model = 0; model < modelNames.size(); ++model)
+        {
+            const ConfigResult* cheapest = nullptr;
+
+            for (const auto& result : results)
+                if (result.config.model == model && result.worstAliasing <= maxAliasing)
+                    if (cheapest == nullptr || result.nsPerSample < cheapest->nsPerSample)
+                        cheapest = &result;
+
+            if (cheapest == nullptr)
+            {
+                std::cout << "  " << modelNames[model] << ": none" << std::endl;
+                continue;
+            }
+
+            std::cout << "  " << cheapest->config.getName() << "  " << juce::String(cheapest->nsPerSample, 2)
+                      << " ns/sample, " << juce::String(cheapest->worstAliasing, 1) << " dBFS" << std::endl;
+            choices.append(cheapest->config.getName());
+        }
+
+        return choices;
+    }
+
+    /** Compares with the results of an earlier run. Returns the number of configurations that got worse. */
+    int compareWithBaseline (const std::vector<ConfigResult>& results, const juce::File& baselineFile, double tolerance)
+    {
+        const auto baseline = juce::JSON::parse(baselineFile.loadFileAsString());
+        const auto* previous = baseline["configurations"].getArray();
+
+        if (previous == nullptr)
+            juce::ConsoleApplication::fail(baselineFile.getFullPathName() + " isn't a DistortionAnalysis result");
+
+        int regressions = 0;
+        int compared = 0;
+
+        for (const auto& result : results)
+        {
+            const auto name = result.config.getName();
+
+            for (const auto& old : *previous)
+            {
+                if (old["name"].toString() != name)
+                    continue;
+
+                ++compared;
+                const auto oldAliasing = static_cast<double>(old["worst_aliasing_dbfs"]);
+                const auto oldThdN = static_cast<double>(old["worst_thd_n_db"]);
+
+                if (result.worstAliasing > oldAliasing + tolerance || result.worstThdN > oldThdN + tolerance)
+                {
+                    std::cout << "regression: " << name
+                              << "  aliasing " << juce::String(oldAliasing, 1) << " -> " << juce::String(result.worstAliasing, 1)
+                              << "  thd+n " << juce::String(oldThdN, 1) << " -> " << juce::String(result.worstThdN, 1) << std::endl;
+                    ++regressions;
+                }
+
+                break;
+            }
+        }
+
+        std::cout << compared << " configurations compared with the baseline, " << regressions << " worse by more than "
+                  << tolerance << " dB" << std::endl;
+        return regressions;
+    }
+
+    //==============================================================================
+    int runAnalysis (const juce::ArgumentList& args)
+    {
+        Settings settings;
+        settings.quick = args.containsOption("--quick");
+        settings.includeFIR = args.containsOption("--fir");
+
+        if (args.containsOption("--sample-rate"))
+            settings.sampleRate = args.getValueForOption("--sample-rate").getDoubleValue();
+
+        if (args.containsOption("--seconds"))
+            settings.seconds = args.getValueForOption("--seconds").getDoubleValue();
+
+        if (args.containsOption("--alias-threshold"))
+            settings.aliasThreshold = args.getValueForOption("--alias-threshold").getFloatValue();
+
+        if (settings.seconds <= 0.0 || settings.sampleRate <= 0.0)
+            juce::ConsoleApplication::fail("--seconds and --sample-rate must be positive");
+
+        for (int i = 0; i < args.size(); ++i)
+            if (args[i].text == "--set" && i + 1 < args.size())
+                settings.extraParameters.add(args[++i].text);
+
+        juce::AudioBuffer<float> source (1, juce::jmax(8192, static_cast<int>(settings.sampleRate)));
+        ToolHelpers::fillTestSignal(source, settings.sampleRate);
+
+        // the direct kernels at each precision, then the table and ADAA engines, which have only one
+        std::vector<std::pair<int, int>> shapers;
+
+        for (int precision = 0; precision < precisionNames.size(); ++precision)
+            if (! settings.quick || precision == 1)
+                shapers.push_back({ 0, precision });
+
+        for (int engine = 1; engine < engineNames.size(); ++engine)
+            if (! settings.quick || engine == 3)
+                shapers.push_back({ engine, 1 });
+
+        const auto numFilters = settings.includeFIR ? 2 : 1;
+        std::vector<ConfigResult> results;
+
+        for (int model = 0; model < modelNames.size(); ++model)
+            for (int oversampling = -1; oversampling <= autoOversampling; ++oversampling)
+                for (int filter = 0; filter < (oversampling < 0 ? 1 : numFilters); ++filter)
+                    for (const auto& shaper : shapers)
+                    {
+                        const Config config { model, oversampling, filter, shaper.first, shaper.second };
+                        std::cerr << config.getName() << std::endl;
+                        results.push_back(runConfig(config, settings, source));
+                    }
+
+        markParetoFront(results);
+        printTable(results);
+
+        auto* root = new juce::DynamicObject();
+
+        if (args.containsOption("--max-aliasing"))
+            root->setProperty("cheapest", chooseCheapest(results, args.getValueForOption("--max-aliasing").getDoubleValue()));
+
+        int regressions = 0;
+
+        if (args.containsOption("--baseline"))
+        {
+            const auto tolerance = args.containsOption("--tolerance") ? args.getValueForOption("--tolerance").getDoubleValue() : 1.0;
+            regressions = compareWithBaseline(results, args.getFileForOption("--baseline"), tolerance);
+        }
+
+        if (args.containsOption("--output"))
+        {
+            auto configurations = juce::var::emptyArray();
+
+            for (const auto& result : results)
+                configurations.append(result.toVar());
+
+            auto* context = new juce::DynamicObject();
+            context->setProperty("date", juce::Time::getCurrentTime().toISO8601(true));
+            context->setProperty("cpu", juce::SystemStats::getCpuModel());
+            context->setProperty("juce_version", juce::SystemStats::getJUCEVersion());
+            context->setProperty("sample_rate", settings.sampleRate);
+            context->setProperty("fft_size", fftSize);
+            context->setProperty("tone_amplitude", toneAmplitude);
+            context->setProperty("alias_threshold", settings.aliasThreshold);
+            context->setProperty("extra_parameters", settings.extraParameters.joinIntoString(" "));
+
+            root->setProperty("context", juce::var(context));
+            root->setProperty("configurations", configurations);
+
+            const auto outputFile = args.getFileForOption("--output");
+
+            if (! outputFile.replaceWithText(juce::JSON::toString(juce::var(root))))
+                juce::ConsoleApplication::fail("couldn't write " + outputFile.getFullPathName());
+        }
+
+        return regressions > 0 ? 1 : 0;
+    }
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    // the parameter state wants a message manager, even with no editor
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::ArgumentList args (argc, argv);
+
+    return juce::ConsoleApplication::invokeCatchingFailures([&] { return runAnalysis(args); });
+}
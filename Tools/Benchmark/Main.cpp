@@ -0,0 +1,454 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    DistortionBenchmark
+
+    Microbenchmarks for the hot path, written out as JSON so runs can be
+    compared between builds.
+
+    The processor sweep times processBlock for every model, with
+    oversampling off and at each factor, in mono, stereo and a 12 channel
+    7.1.4 bed, the tone filters off, on at the host rate and (when
+    oversampling) fused into the oversampled pass, across block sizes from
+    16 to 4096. The kernel sweep times
+    the shaping kernels on their own, for every model and precision.
+
+    Before anything is timed, every kernel is checked against the scalar
+    libm reference, in float and double, at every alignment and at lengths
+    that leave an unaligned head, whole registers and a scalar tail. High
+    has to stay within -120 dB of it and Eco within -75 dB; Exact is the
+    reference itself and has to match to the bit. A kernel outside its
+    bound fails the run. --verify-kernels runs only this check.
+
+      DistortionBenchmark [--output results.json] [--quick]
+                          [--seconds 1] [--repetitions 5]
+                          [--sample-rate 48000] [--fir] [--kernels-only]
+                          [--verify-kernels]
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+#include "DistortionKernels.h"
+#include "../Shared/ToolHelpers.h"
+
+namespace
+{
+    const juce::StringArray modelNames = {"Soft", "Hard", "Tube", "Half-Wave", "Full-Wave", "Sine"};
+    const juce::StringArray precisionNames = {"Exact", "High", "Eco"};
+    const juce::StringArray factorNames = {"2x", "4x", "8x", "16x"};
+    const juce::StringArray filterNames = {"IIR", "FIR"};
+
+    struct Settings
+    {
+        double sampleRate = 48000.0;
+        double seconds = 1.0;
+        int repetitions = 5;
+        bool quick = false;
+        bool includeFIR = false;
+    };
+
+    struct Timing
+    {
+        double median = 0.0; // seconds
+        double fastest = 0.0;
+    };
+
+    Timing summarise (std::vector<double>& runs)
+    {
+        std::sort(runs.begin(), runs.end());
+        return { runs[runs.size() / 2], runs.front() };
+    }
+
+    void setParameter (DistortionOversamplingAudioProcessor& processor, const juce::String& id, int value)
+    {
+        const auto result = ToolHelpers::applyParameter(processor.treeState, id + "=" + juce::String(value));
+
+        if (result.failed())
+            juce::ConsoleApplication::fail(result.getErrorMessage());
+    }
+
+    //==============================================================================
+    struct ProcessorCase
+    {
+        int model;
+        int oversampling; // -1 is off, otherwise the factor index
+        int filter;
+        int numChannels;
+        int blockSize;
+        int tone;         // 0 is off, 1 at the host rate, 2 pre and post fused into the oversampled pass
+
+        juce::String getToneName() const
+        {
+            return tone == 0 ? "off" : (tone == 1 ? "host" : "fused");
+        }
+
+        juce::String getName() const
+        {
+            const auto os = oversampling < 0 ? juce::String("off") : factorNames[oversampling] + " " + filterNames[filter];
+            return modelNames[model] + "/os:" + os + "/ch:" + juce::String(numChannels)
+                 + "/block:" + juce::String(blockSize) + "/tone:" + getToneName();
+        }
+    };
+
+    juce::var runProcessorCase (const ProcessorCase& c, const Settings& settings, const juce::AudioBuffer<float>& source)
+    {
+        DistortionOversamplingAudioProcessor processor;
+
+        // timed the way a host runs it with no editor open, without paying for measurements
+        processor.getInstrumentation().setEnabled(false);
+
+        setParameter(processor, "model", c.model);
+        setParameter(processor, "input", 12);
+        setParameter(processor, "oversample", c.oversampling >= 0 ? 1 : 0);
+        setParameter(processor, "os factor", juce::jmax(0, c.oversampling));
+        setParameter(processor, "os filter", c.filter);
+        setParameter(processor, "pre tone", c.tone > 0 ? 1 : 0);
+        setParameter(processor, "pre cutoff", 80);
+        setParameter(processor, "post tone", c.tone > 0 ? 1 : 0);
+        setParameter(processor, "post cutoff", 8000);
+        setParameter(processor, "tone placement", c.tone == 2 ? 2 : 0);
+
+        const auto prepared = ToolHelpers::prepareProcessor(processor, settings.sampleRate, c.blockSize, c.numChannels, false);
+
+        if (prepared.failed())
+            juce::ConsoleApplication::fail(prepared.getErrorMessage());
+
+        juce::AudioBuffer<float> buffer (c.numChannels, c.blockSize);
+        juce::MidiBuffer midi;
+
+        const auto blocksPerRun = juce::jmax(1, static_cast<int>(settings.seconds * settings.sampleRate) / c.blockSize);
+        const auto sourceBlocks = source.getNumSamples() / c.blockSize;
+        int sourceBlock = 0;
+
+        // only processBlock is timed; the copy in stands in for the host filling the buffer
+        auto runBlocks = [&] (int numBlocks)
+        {
+            juce::int64 ticks = 0;
+
+            for (int i = 0; i < numBlocks; ++i)
+            {
+                for (int ch = 0; ch < c.numChannels; ++ch)
+                    buffer.copyFrom(ch, 0, source, ch % source.getNumChannels(), sourceBlock * c.blockSize, c.blockSize);
+
+                sourceBlock = (sourceBlock + 1) % sourceBlocks;
+
+                const auto start = juce::Time::getHighResolutionTicks();
+                processor.processBlock(buffer, midi);
+                ticks += juce::Time::getHighResolutionTicks() - start;
+            }
+
+            return juce::Time::highResolutionTicksToSeconds(ticks);
+        };
+
+        runBlocks(juce::jmax(1, blocksPerRun / 10)); // warm up caches and filter state
+
+        std::vector<double> runs;
+
+        for (int i = 0; i < settings.repetitions; ++i)
+            runs.push_back(runBlocks(blocksPerRun));
+
+        processor.releaseResources();
+
+        const auto timing = summarise(runs);
+        const auto samplesPerRun = static_cast<double>(blocksPerRun) * c.blockSize;
+        const auto audioSeconds = samplesPerRun / settings.sampleRate;
+
+        auto* result = new juce::DynamicObject();
+        result->setProperty("name", c.getName());
+        result->setProperty("model", modelNames[c.model]);
+        result->setProperty("oversampling", c.oversampling < 0 ? juce::String("off") : factorNames[c.oversampling]);
+        result->setProperty("os_filter", c.oversampling < 0 ? juce::String() : filterNames[c.filter]);
+        result->setProperty("channels", c.numChannels);
+        result->setProperty("block_size", c.blockSize);
+        result->setProperty("tone_filters", c.getToneName());
+        result->setProperty("latency_samples", processor.getLatencySamples());
+        result->setProperty("ns_per_sample", timing.median * 1.0e9 / (samplesPerRun * c.numChannels));
+        result->setProperty("ns_per_sample_fastest", timing.fastest * 1.0e9 / (samplesPerRun * c.numChannels));
+        result->setProperty("realtime_factor", audioSeconds / timing.median);
+        return juce::var(result);
+    }
+
+    //==============================================================================
+    juce::var runKernelCase (int model, int precision, const Settings& settings, const juce::AudioBuffer<float>& source)
+    {
+        constexpr int chunkSize = 4096;
+        const auto kernel = DistortionKernels::getKernel<float>(model, static_cast<DistortionKernels::Precision>(precision));
+        const auto drive = juce::Decibels::decibelsToGain(12.0f);
+
+        juce::AudioBuffer<float> buffer (1, chunkSize);
+        const auto chunksPerRun = juce::jmax(1, static_cast<int>(settings.seconds * settings.sampleRate) / chunkSize);
+
+        auto runChunks = [&] (int numChunks)
+        {
+            juce::int64 ticks = 0;
+
+            for (int i = 0; i < numChunks; ++i)
+            {
+                buffer.copyFrom(0, 0, source, 0, 0, chunkSize);
+
+                const auto start = juce::Time::getHighResolutionTicks();
+                kernel(buffer.getWritePointer(0), chunkSize, drive);
+                ticks += juce::Time::getHighResolutionTicks() - start;
+            }
+
+            return juce::Time::highResolutionTicksToSeconds(ticks);
+        };
+
+        runChunks(juce::jmax(1, chunksPerRun / 10));
+
+        std::vector<double> runs;
+
+        for (int i = 0; i < settings.repetitions; ++i)
+            runs.push_back(runChunks(chunksPerRun));
+
+        const auto timing = summarise(runs);
+        const auto samplesPerRun = static_cast<double>(chunksPerRun) * chunkSize;
+
+        auto* result = new juce::DynamicObject();
+        result->setProperty("name", "kernel/" + modelNames[model] + "/" + precisionNames[precision]);
+        result->setProperty("model", modelNames[model]);
+        result->setProperty("precision", precisionNames[precision]);
+        result->setProperty("ns_per_sample", timing.median * 1.0e9 / samplesPerRun);
+        result->setProperty("ns_per_sample_fastest", timing.fastest * 1.0e9 / samplesPerRun);
+        return juce::var(result);
+    }
+
+    //==============================================================================
+    // largest error allowed against the reference, by precision, as documented in DistortionKernels.h
+    const double kernelErrorBounds[] = { 0.0, juce::Decibels::decibelsToGain(-120.0), juce::Decibels::decibelsToGain(-75.0) };
+
+    constexpr int maxCheckLength = 67;  // a few registers of either type, plus an odd tail
+    constexpr int maxCheckOffset = 8;   // every alignment of the widest register
+
+    // a sweep over +-4 with, every few samples, a point where a mask flips at this drive: zero for Tube's
+    // select, the rectifier biases, and the values either side of each, so each lands in the head, body and tail
+    template <typename SampleType>
+    std::vector<SampleType> makeCheckInput (SampleType drive)
+    {
+        std::vector<SampleType> edges;
+
+        for (auto edge : { SampleType(0), SampleType(-0.15) / drive, SampleType(-0.1) / drive, SampleType(1) / drive, SampleType(-1) / drive })
+        {
+            edges.push_back(edge);
+            edges.push_back(std::nextafter(edge, SampleType(-1)));
+            edges.push_back(std::nextafter(edge, SampleType(1)));
+        }
+
+        edges.push_back(SampleType(-0.0));
+
+        std::vector<SampleType> input (1024);
+
+        for (size_t i = 0; i < input.size(); ++i)
+            input[i] = i % 3 == 0 ? edges[(i / 3) % edges.size()]
+                                  : static_cast<SampleType>(-4.0 + 8.0 * static_cast<double>(i) / static_cast<double>(input.size()));
+
+        return input;
+    }
+
+    // runs the fast kernel in place at data and the reference on a copy, and returns the largest difference
+    template <typename SampleType, typename Run, typename RunReference>
+    double compareKernel (SampleType* data, const SampleType* source, int numSamples, Run&& run, RunReference&& runReference)
+    {
+        std::vector<SampleType> expected (source, source + numSamples);
+        std::copy(source, source + numSamples, data);
+
+        run(data);
+        runReference(expected.data());
+
+        double error = 0.0;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const auto difference = std::abs(static_cast<double>(data[i]) - static_cast<double>(expected[i]));
+
+            // a NaN anywhere counts as over any bound
+            error = difference == difference ? juce::jmax(error, difference) : std::numeric_limits<double>::infinity();
+        }
+
+        return error;
+    }
+
+    template <typename SampleType>
+    void verifyKernels (juce::StringArray& failures)
+    {
+        const auto typeName = sizeof(SampleType) == sizeof(float) ? juce::String("float") : juce::String("double");
+        const SampleType drives[] = { SampleType(1), SampleType(2), SampleType(4), SampleType(15.85) };
+
+        // the data is placed at each offset from a 64 byte boundary, so the kernels see every alignment
+        juce::HeapBlock<char> storage (64 + (maxCheckOffset + maxCheckLength) * sizeof(SampleType));
+        auto* base = reinterpret_cast<SampleType*>((reinterpret_cast<std::uintptr_t>(storage.get()) + 63) & ~std::uintptr_t(63));
+
+        // the ramp is one sample out of step with the data, so the two never share an alignment
+        std::vector<SampleType> rampStorage (maxCheckOffset + maxCheckLength + 1);
+
+        for (size_t i = 0; i < rampStorage.size(); ++i)
+            rampStorage[i] = static_cast<SampleType>(1.0 + 14.85 * static_cast<double>(i) / static_cast<double>(rampStorage.size()));
+
+        for (int model = 0; model < modelNames.size(); ++model)
+        {
+            for (int precision = 0; precision < precisionNames.size(); ++precision)
+            {
+                const auto kernelPrecision = static_cast<DistortionKernels::Precision>(precision);
+                const auto kernel = DistortionKernels::getKernel<SampleType>(model, kernelPrecision);
+                const auto reference = DistortionKernels::getReferenceKernel<SampleType>(model);
+                const auto rampKernel = DistortionKernels::getRampKernel<SampleType>(model, kernelPrecision);
+                const auto rampReference = DistortionKernels::getReferenceRampKernel<SampleType>(model);
+
+                double worst = 0.0;
+                juce::String worstCase;
+
+                auto note = [&] (double error, const juce::String& where)
+                {
+                    if (! (error <= worst))
+                    {
+                        worst = error;
+                        worstCase = where;
+                    }
+                };
+
+                for (auto drive : drives)
+                {
+                    const auto input = makeCheckInput(drive);
+
+                    for (int offset = 0; offset < maxCheckOffset; ++offset)
+                    {
+                        for (int length = 0; length <= maxCheckLength; ++length)
+                        {
+                            const auto* source = input.data() + (length * 7 + offset * 13) % (static_cast<int>(input.size()) - maxCheckLength);
+                            const auto* ramp = rampStorage.data() + offset + 1;
+                            const auto where = "drive " + juce::String(drive, 2) + ", offset " + juce::String(offset) + ", length " + juce::String(length);
+
+                            note(compareKernel(base + offset, source, length,
+                                               [&] (SampleType* data) { kernel(data, length, drive); },
+                                               [&] (SampleType* data) { reference(data, length, drive); }),
+                                 where);
+
+                            note(compareKernel(base + offset, source, length,
+                                               [&] (SampleType* data) { rampKernel(data, ramp, length); },
+                                               [&] (SampleType* data) { rampReference(data, ramp, length); }),
+                                 where + ", drive ramp");
+                        }
+                    }
+                }
+
+                const auto bound = kernelErrorBounds[precision];
+
+                if (! (worst <= bound))
+                    failures.add(modelNames[model] + "/" + precisionNames[precision] + "/" + typeName + " is "
+                                 + juce::String(juce::Decibels::gainToDecibels(worst, -400.0), 1) + " dB off the reference at " + worstCase
+                                 + (bound > 0.0 ? ", over its bound of " + juce::String(juce::Decibels::gainToDecibels(bound), 1) + " dB"
+                                                : juce::String(", where it has to match exactly")));
+            }
+        }
+    }
+
+    //==============================================================================
+    int runBenchmarks (const juce::ArgumentList& args)
+    {
+        // timings from kernels that don't produce the right output mean nothing, so they are checked first
+        juce::StringArray failures;
+        verifyKernels<float>(failures);
+        verifyKernels<double>(failures);
+
+        if (! failures.isEmpty())
+            juce::ConsoleApplication::fail("kernel check failed:\n" + failures.joinIntoString("\n"));
+
+        if (args.containsOption("--verify-kernels"))
+        {
+            std::cout << "every kernel is within its bound of the reference" << std::endl;
+            return 0;
+        }
+
+        Settings settings;
+        settings.quick = args.containsOption("--quick");
+        settings.includeFIR = args.containsOption("--fir");
+
+        if (args.containsOption("--seconds"))
+            settings.seconds = args.getValueForOption("--seconds").getDoubleValue();
+
+        if (args.containsOption("--repetitions"))
+            settings.repetitions = args.getValueForOption("--repetitions").getIntValue();
+
+        if (args.containsOption("--sample-rate"))
+            settings.sampleRate = args.getValueForOption("--sample-rate").getDoubleValue();
+
+        if (settings.seconds <= 0.0 || settings.repetitions <= 0 || settings.sampleRate <= 0.0)
+            juce::ConsoleApplication::fail("--seconds, --repetitions and --sample-rate must be positive");
+
+        // one second of test signal, long enough that the largest block doesn't repeat straight away
+        juce::AudioBuffer<float> source (2, juce::jmax(8192, static_cast<int>(settings.sampleRate)));
+        ToolHelpers::fillTestSignal(source, settings.sampleRate);
+
+        auto benchmarks = juce::var::emptyArray();
+
+        for (int model = 0; model < modelNames.size(); ++model)
+            for (int precision = 0; precision < precisionNames.size(); ++precision)
+                benchmarks.append(runKernelCase(model, precision, settings, source));
+
+        if (! args.containsOption("--kernels-only"))
+        {
+            const std::vector<int> blockSizes = settings.quick ? std::vector<int> { 64, 512, 4096 }
+                                                               : std::vector<int> { 16, 32, 64, 128, 256, 512, 1024, 2048, 4096 };
+            const std::vector<int> channelCounts { 1, 2, 12 };
+            const auto numFilters = settings.includeFIR ? 2 : 1;
+
+            for (int model = 0; model < modelNames.size(); ++model)
+                for (int oversampling = -1; oversampling < factorNames.size(); ++oversampling)
+                    for (int filter = 0; filter < (oversampling < 0 ? 1 : numFilters); ++filter)
+                        for (auto numChannels : channelCounts)
+                            for (auto blockSize : blockSizes)
+                                for (int tone = 0; tone < (oversampling < 0 ? 2 : 3); ++tone)
+                                {
+                                    const ProcessorCase c { model, oversampling, filter, numChannels, blockSize, tone };
+                                    std::cerr << c.getName() << std::endl;
+                                    benchmarks.append(runProcessorCase(c, settings, source));
+                                }
+        }
+
+        auto* context = new juce::DynamicObject();
+        context->setProperty("date", juce::Time::getCurrentTime().toISO8601(true));
+        context->setProperty("cpu", juce::SystemStats::getCpuModel());
+        context->setProperty("num_cpus", juce::SystemStats::getNumCpus());
+        context->setProperty("os", juce::SystemStats::getOperatingSystemName());
+        context->setProperty("juce_version", juce::SystemStats::getJUCEVersion());
+        context->setProperty("simd", DISTORTION_USE_SIMD != 0);
+        context->setProperty("sample_rate", settings.sampleRate);
+        context->setProperty("seconds_per_run", settings.seconds);
+        context->setProperty("repetitions", settings.repetitions);
+        context->setProperty("instrumentation", false);
+
+        auto* root = new juce::DynamicObject();
+        root->setProperty("context", juce::var(context));
+        root->setProperty("benchmarks", benchmarks);
+
+        const auto json = juce::JSON::toString(juce::var(root));
+
+        if (args.containsOption("--output"))
+        {
+            const auto outputFile = args.getFileForOption("--output");
+
+            if (! outputFile.replaceWithText(json))
+                juce::ConsoleApplication::fail("couldn't write " + outputFile.getFullPathName());
+        }
+        else
+        {
+            std::cout << json << std::endl;
+        }
+
+        return 0;
+    }
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    // the parameter state wants a message manager, even with no editor
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::ArgumentList args (argc, argv);
+
+    return juce::ConsoleApplication::invokeCatchingFailures([&] { return runBenchmarks(args); });
+}
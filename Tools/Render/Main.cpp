@@ -0,0 +1,446 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    DistortionRender
+
+    Offline render. Streams an audio file through the processor block by
+    block, the same way a host would, and writes the result with the
+    plugin's latency trimmed off so the output lines up with the input.
+
+      DistortionRender --input in.wav --output out.flac
+                       [--block-size 512] [--bits 24]
+                       [--jobs 1] [--chunk-seconds 30] [--warm-up-seconds 1]
+                       [--verify] [--set "id=value"]... [--stats]
+
+    With --jobs above 1 the file is split into chunks, each rendered by its
+    own processor on a pool thread and written back in order. A chunk's
+    processor starts --warm-up-seconds early, on the same block boundaries
+    as the serial render, so the filters, the oversampler and the smoothing
+    have settled by the time its output is kept. Only a few chunks are held
+    at once, however long the file.
+
+    The output has to match the serial render to the bit, and a warm-up
+    alone can't promise that: a recursive filter never strictly forgets
+    where it started, and the auto oversampling hold and the crossfades
+    depend on history too. So the second half of each warm-up is kept as
+    an overlap with the chunk before, where that chunk's output is already
+    known. A chunk that doesn't match it to the bit is thrown away and
+    rendered again by the previous chunk's processor, carrying on from
+    where it stopped, exactly as the serial render would. At the default
+    warm-up the overlap is half a second. That outlasts the auto
+    oversampling hold and a crossfade, so a difference in either shows up
+    inside it.
+
+    --verify also renders the file serially alongside, writes that instead,
+    and fails if any chunk sample differed from it.
+
+    --stats prints the processor's instrumentation as JSON afterwards: one
+    report per 1024 blocks (and per chunk), each with the time spent in
+    every stage and the input and output levels.
+
+      DistortionRender --list-params
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+#include "../Shared/ToolHelpers.h"
+
+namespace
+{
+    /** One processor streaming the file, with its latency taken off so output sample n lines
+        up with input sample n. The output has to be asked for in order, from the sample it was
+        created for. It is set up on the calling thread; render() can then run on any thread.
+    */
+    class StreamRenderer
+    {
+    public:
+        StreamRenderer (juce::AudioFormatManager& formatManager, const juce::File& inputFile, const juce::ArgumentList& args,
+                        int blockSizeToUse, juce::int64 firstSample, juce::int64 warmUpSamples, bool collectStats)
+            : blockSize (blockSizeToUse), printStats (collectStats)
+        {
+            // each renderer reads on its own thread, so each gets its own reader
+            reader.reset(formatManager.createReaderFor(inputFile));
+
+            if (reader == nullptr)
+                juce::ConsoleApplication::fail("couldn't read " + inputFile.getFullPathName());
+
+            const auto numChannels = static_cast<int>(reader->numChannels);
+
+            processor.getInstrumentation().setEnabled(printStats);
+
+            // parameters go in before prepareToPlay, so the reported latency already reflects them
+            const auto parameterResult = ToolHelpers::applyParameters(processor.treeState, args);
+
+            if (parameterResult.failed())
+                juce::ConsoleApplication::fail(parameterResult.getErrorMessage());
+
+            const auto prepareResult = ToolHelpers::prepareProcessor(processor, reader->sampleRate, blockSize, numChannels, true);
+
+            if (prepareResult.failed())
+                juce::ConsoleApplication::fail(prepareResult.getErrorMessage());
+
+            latency = processor.getLatencySamples();
+            buffer.setSize(numChannels, blockSize);
+
+            // output sample n comes from input sample n, so the warm-up is counted back from the first input that
+            // matters. Starting on the serial render's block grid means every block processed here is one it processes too
+            const auto warmUpStart = juce::jmax(static_cast<juce::int64>(0), firstSample - warmUpSamples);
+            readPosition = warmUpStart - warmUpStart % blockSize;
+            outputPosition = firstSample;
+        }
+
+        ~StreamRenderer()
+        {
+            processor.releaseResources();
+        }
+
+        int getLatency() const noexcept { return latency; }
+
+        /** Renders the next numSamples of output into dest, from destStart. */
+        void render (juce::AudioBuffer<float>& dest, int destStart, int numSamples)
+        {
+            while (numSamples > 0)
+            {
+                // the output we want is `latency` samples further on in the processor's output. Reads past
+                // the end of the file come back as silence, which flushes the last samples out
+                const auto processorPosition = outputPosition + latency;
+
+                if (processorPosition >= readPosition)
+                {
+                    processNextBlock();
+                    continue;
+                }
+
+                const auto offset = static_cast<int>(processorPosition - (readPosition - blockSize));
+                jassert (offset >= 0);
+
+                const auto numToCopy = juce::jmin(numSamples, blockSize - offset);
+
+                for (int ch = 0; ch < dest.getNumChannels(); ++ch)
+                    dest.copyFrom(ch, destStart, buffer, ch, offset, numToCopy);
+
+                destStart += numToCopy;
+                numSamples -= numToCopy;
+                outputPosition += numToCopy;
+            }
+        }
+
+        /** The instrumentation reports so far, with whatever the last full report left over. */
+        juce::Array<juce::var> takeReports()
+        {
+            if (printStats && numBlocks % blocksPerReport != 0)
+                reports.add(processor.getInstrumentation().collect().toVar());
+
+            numBlocks = 0;
+            return std::move(reports);
+        }
+
+    private:
+        void processNextBlock()
+        {
+            reader->read(&buffer, 0, blockSize, readPosition, true, true);
+            readPosition += blockSize;
+
+            processor.processBlock(buffer, midi);
+
+            if (printStats && ++numBlocks % blocksPerReport == 0)
+                reports.add(processor.getInstrumentation().collect().toVar());
+        }
+
+        // collected well before the fifo fills up, so no block is dropped
+        static constexpr int blocksPerReport = Instrumentation::capacity / 2;
+
+        DistortionOversamplingAudioProcessor processor;
+        std::unique_ptr<juce::AudioFormatReader> reader;
+        juce::AudioBuffer<float> buffer;
+        juce::MidiBuffer midi;
+
+        const int blockSize;
+        const bool printStats;
+        int latency = 0;
+        juce::int64 readPosition = 0;   // the input sample the next block starts at
+        juce::int64 outputPosition = 0; // the next output sample render() hands out
+
+        juce::Array<juce::var> reports;
+        int numBlocks = 0;
+    };
+
+    //==============================================================================
+    /** A stretch of the output, rendered on a pool thread by its own processor. The output starts
+        with the overlap: the last samples of the chunk before, which it is checked against.
+    */
+    struct Chunk
+    {
+        Chunk (std::unique_ptr<StreamRenderer> rendererToUse, int numChannels, int overlapToUse, int numSamplesToUse)
+            : renderer (std::move(rendererToUse)), output (numChannels, overlapToUse + numSamplesToUse),
+              overlap (overlapToUse), numSamples (numSamplesToUse)
+        {
+        }
+
+        std::unique_ptr<StreamRenderer> renderer;
+        juce::AudioBuffer<float> output;
+        const int overlap;
+        const int numSamples;
+        std::atomic<bool> finished { false };
+    };
+
+    /** True if the first overlap samples of output are the last overlap samples of tail, to the bit. */
+    bool matchesTail (const juce::AudioBuffer<float>& output, const juce::AudioBuffer<float>& tail, int overlap)
+    {
+        const auto tailStart = tail.getNumSamples() - overlap;
+
+        for (int ch = 0; ch < output.getNumChannels(); ++ch)
+            if (std::memcmp(output.getReadPointer(ch), tail.getReadPointer(ch, tailStart), static_cast<size_t>(overlap) * sizeof(float)) != 0)
+                return false;
+
+        return true;
+    }
+}
+
+//==============================================================================
+static int render (const juce::ArgumentList& args)
+{
+    if (args.containsOption("--list-params"))
+    {
+        DistortionOversamplingAudioProcessor processor;
+        ToolHelpers::printParameters(processor);
+        return 0;
+    }
+
+    const auto inputFile = args.getExistingFileForOption("--input");
+    const auto outputFile = args.getFileForOption("--output");
+    const auto blockSize = args.containsOption("--block-size") ? args.getValueForOption("--block-size").getIntValue() : 512;
+    const auto bitDepth = args.containsOption("--bits") ? args.getValueForOption("--bits").getIntValue() : 24;
+    const auto numJobs = args.containsOption("--jobs") ? args.getValueForOption("--jobs").getIntValue() : 1;
+    const auto chunkSeconds = args.containsOption("--chunk-seconds") ? args.getValueForOption("--chunk-seconds").getDoubleValue() : 30.0;
+    const auto warmUpSeconds = args.containsOption("--warm-up-seconds") ? args.getValueForOption("--warm-up-seconds").getDoubleValue() : 1.0;
+
+    const auto printStats = args.containsOption("--stats");
+    const auto verify = args.containsOption("--verify");
+
+    if (blockSize <= 0)
+        juce::ConsoleApplication::fail("--block-size must be a positive number of samples");
+
+    if (numJobs <= 0 || chunkSeconds <= 0.0 || warmUpSeconds < 0.0)
+        juce::ConsoleApplication::fail("--jobs and --chunk-seconds must be positive, and --warm-up-seconds can't be negative");
+
+    juce::AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+
+    std::unique_ptr<juce::AudioFormatReader> reader (formatManager.createReaderFor(inputFile));
+
+    if (reader == nullptr)
+        juce::ConsoleApplication::fail("couldn't read " + inputFile.getFullPathName());
+
+    auto* outputFormat = formatManager.findFormatForFileExtension(outputFile.getFileExtension());
+
+    if (outputFormat == nullptr)
+        juce::ConsoleApplication::fail("no writer for " + outputFile.getFileExtension() + " files, use .wav or .flac");
+
+    if (! outputFormat->getPossibleBitDepths().contains(bitDepth))
+        juce::ConsoleApplication::fail(outputFormat->getFormatName() + " can't be written at " + juce::String(bitDepth) + " bits");
+
+    const auto sampleRate = reader->sampleRate;
+    const auto numChannels = static_cast<int>(reader->numChannels);
+    const auto totalSamples = reader->lengthInSamples;
+
+    const auto chunkSamples = juce::jmax(static_cast<juce::int64>(blockSize), static_cast<juce::int64>(chunkSeconds * sampleRate));
+    const auto warmUpSamples = static_cast<juce::int64>(warmUpSeconds * sampleRate);
+    const auto overlapSamples = static_cast<int>(juce::jmin(warmUpSamples / 2, chunkSamples));
+
+    // the serial render, or the reference the chunks are checked against
+    std::unique_ptr<StreamRenderer> serial;
+
+    if (numJobs == 1 || verify)
+        serial = std::make_unique<StreamRenderer>(formatManager, inputFile, args, blockSize, 0, 0, printStats && numJobs == 1);
+
+    outputFile.deleteFile();
+    auto stream = std::make_unique<juce::FileOutputStream>(outputFile);
+
+    if (stream->failedToOpen())
+        juce::ConsoleApplication::fail("couldn't write " + outputFile.getFullPathName());
+
+    std::unique_ptr<juce::AudioFormatWriter> writer (outputFormat->createWriterFor(stream.get(), sampleRate, static_cast<unsigned int>(numChannels),
+                                                                                   bitDepth, {}, 0));
+
+    if (writer == nullptr)
+        juce::ConsoleApplication::fail("couldn't create a " + outputFormat->getFormatName() + " writer");
+
+    stream.release(); // the writer owns it now
+
+    juce::Array<juce::var> reports;
+    juce::int64 samplesWritten = 0;
+    int latency = 0;
+    int chunksRerendered = 0;
+
+    juce::AudioBuffer<float> reference (numChannels, numJobs == 1 ? blockSize : static_cast<int>(chunkSamples));
+    juce::int64 samplesDiffering = 0;
+    juce::int64 firstDifference = -1;
+    float largestDifference = 0.0f;
+
+    auto write = [&] (const juce::AudioBuffer<float>& source, int sourceStart, int numSamples)
+    {
+        const auto* toWrite = &source;
+        auto writeStart = sourceStart;
+
+        // the serial render is what goes to disk, so a difference is reported but never written
+        if (verify && numJobs > 1)
+        {
+            serial->render(reference, 0, numSamples);
+
+            for (int ch = 0; ch < numChannels; ++ch)
+            {
+                const float* rendered = source.getReadPointer(ch, sourceStart);
+                const float* expected = reference.getReadPointer(ch);
+
+                for (int i = 0; i < numSamples; ++i)
+                {
+                    if (rendered[i] == expected[i])
+                        continue;
+
+                    if (firstDifference < 0 || samplesWritten + i < firstDifference)
+                        firstDifference = samplesWritten + i;
+
+                    largestDifference = juce::jmax(largestDifference, std::abs(rendered[i] - expected[i]));
+                    ++samplesDiffering;
+                }
+            }
+
+            toWrite = &reference;
+            writeStart = 0;
+        }
+
+        if (! writer->writeFromAudioSampleBuffer(*toWrite, writeStart, numSamples))
+            juce::ConsoleApplication::fail("write failed after " + juce::String(samplesWritten) + " samples");
+
+        samplesWritten += numSamples;
+    };
+
+    const auto startTime = juce::Time::getMillisecondCounterHiRes();
+
+    if (numJobs == 1)
+    {
+        latency = serial->getLatency();
+
+        while (samplesWritten < totalSamples)
+        {
+            const auto numSamples = static_cast<int>(juce::jmin(static_cast<juce::int64>(blockSize), totalSamples - samplesWritten));
+            serial->render(reference, 0, numSamples);
+            write(reference, 0, numSamples);
+        }
+
+        reports = serial->takeReports();
+    }
+    else
+    {
+        const auto numChunks = static_cast<int>((totalSamples + chunkSamples - 1) / chunkSamples);
+        std::vector<std::unique_ptr<Chunk>> chunks (static_cast<size_t>(numChunks));
+        juce::WaitableEvent chunkFinished;
+
+        // declared after the chunks, so if a write fails the pool finishes its jobs before they go
+        juce::ThreadPool pool (numJobs);
+        int numQueued = 0;
+
+        // the processor that rendered the last chunk written, which has stopped where the next one starts,
+        // and that chunk's last samples, which the next chunk's overlap has to match
+        std::unique_ptr<StreamRenderer> previousRenderer;
+        juce::AudioBuffer<float> previousTail (numChannels, overlapSamples);
+
+        for (int next = 0; next < numChunks; ++next)
+        {
+            // keep every thread busy, with a bounded number of chunks waiting to be written. The processors are
+            // made and prepared here, on the message thread, and only process on the pool
+            while (numQueued < numChunks && numQueued < next + 2 * numJobs)
+            {
+                const auto firstSample = numQueued * chunkSamples;
+                const auto numSamples = static_cast<int>(juce::jmin(chunkSamples, totalSamples - firstSample));
+                const auto overlap = static_cast<int>(juce::jmin(static_cast<juce::int64>(overlapSamples), firstSample));
+
+                // the warm-up runs up to the start of the overlap, and the overlap is rendered and kept
+                auto renderer = std::make_unique<StreamRenderer>(formatManager, inputFile, args, blockSize, firstSample - overlap,
+                                                                 warmUpSamples - overlap, printStats);
+                latency = renderer->getLatency();
+
+                auto& slot = chunks[static_cast<size_t>(numQueued++)];
+                slot = std::make_unique<Chunk>(std::move(renderer), numChannels, overlap, numSamples);
+                auto* chunk = slot.get();
+
+                pool.addJob([chunk, &chunkFinished]
+                {
+                    chunk->renderer->render(chunk->output, 0, chunk->output.getNumSamples());
+                    chunk->finished = true;
+                    chunkFinished.signal();
+                });
+            }
+
+            auto& chunk = chunks[static_cast<size_t>(next)];
+
+            while (! chunk->finished)
+                chunkFinished.wait();
+
+            // the previous chunk matches the serial render, so a chunk whose overlap matches it has settled into
+            // the same state. One that doesn't, or that has no overlap to check, is rendered again by the previous
+            // chunk's processor instead
+            if (next > 0 && (chunk->overlap == 0 || ! matchesTail(chunk->output, previousTail, chunk->overlap)))
+            {
+                previousRenderer->render(chunk->output, chunk->overlap, chunk->numSamples);
+                chunk->renderer = std::move(previousRenderer);
+                ++chunksRerendered;
+            }
+
+            write(chunk->output, chunk->overlap, chunk->numSamples);
+            reports.addArray(chunk->renderer->takeReports());
+
+            const auto tailLength = juce::jmin(overlapSamples, chunk->numSamples);
+
+            for (int ch = 0; ch < numChannels; ++ch)
+                previousTail.copyFrom(ch, overlapSamples - tailLength, chunk->output, ch, chunk->output.getNumSamples() - tailLength, tailLength);
+
+            previousRenderer = std::move(chunk->renderer);
+            chunk.reset();
+        }
+    }
+
+    const auto elapsedSeconds = (juce::Time::getMillisecondCounterHiRes() - startTime) / 1000.0;
+    const auto audioSeconds = static_cast<double>(totalSamples) / sampleRate;
+
+    writer.reset();
+
+    std::cout << "rendered " << audioSeconds << " s of audio in " << elapsedSeconds << " s ("
+              << audioSeconds / juce::jmax(elapsedSeconds, 1.0e-9) << "x real time) on " << numJobs
+              << (numJobs == 1 ? " thread" : " threads") << ", latency " << latency << " samples compensated" << std::endl;
+
+    if (chunksRerendered > 0)
+        std::cout << chunksRerendered << (chunksRerendered == 1 ? " chunk" : " chunks")
+                  << " didn't match the chunk before and had to be rendered again in order. A longer --warm-up-seconds avoids that" << std::endl;
+
+    if (printStats)
+        std::cout << juce::JSON::toString(juce::var(reports)) << std::endl;
+
+    if (verify && samplesDiffering > 0)
+    {
+        std::cout << samplesDiffering << " samples of the chunks differed from the serial render, by up to "
+                  << juce::Decibels::gainToDecibels(largestDifference) << " dBFS, the first at sample " << firstDifference
+                  << ". The serial render was written instead" << std::endl;
+        return 1;
+    }
+
+    if (verify)
+        std::cout << "identical to the serial render" << std::endl;
+
+    return 0;
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    // the parameter state wants a message manager, even with no editor
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::ArgumentList args (argc, argv);
+
+    return juce::ConsoleApplication::invokeCatchingFailures([&] { return render(args); });
+}
@@ -0,0 +1,140 @@
+/*
+  ==============================================================================
+
+    ToolHelpers.h
+
+    Bits the command line tools share: setting parameters from the command
+    line and preparing a headless processor the way a host would.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <iostream>
+
+namespace ToolHelpers
+{
+    /** Sets one parameter from "id=value". The value is either a number in the parameter's own
+        units (a choice index, 0/1 for toggles) or text the parameter understands, like "Tube".
+    */
+    inline juce::Result applyParameter (juce::AudioProcessorValueTreeState& state, const juce::String& assignment)
+    {
+        if (! assignment.contains("="))
+            return juce::Result::fail("expected id=value, got \"" + assignment + "\"");
+
+        const auto id = assignment.upToFirstOccurrenceOf("=", false, false).trim();
+        const auto text = assignment.fromFirstOccurrenceOf("=", false, false).trim();
+        auto* parameter = state.getParameter(id);
+
+        if (parameter == nullptr)
+            return juce::Result::fail("unknown parameter \"" + id + "\"");
+
+        if (text.isEmpty())
+            return juce::Result::fail("no value given for \"" + id + "\"");
+
+        float value = 0.0f;
+
+        if (text.containsOnly("0123456789.-+eE"))
+        {
+            value = parameter->convertTo0to1(text.getFloatValue());
+        }
+        else if (auto* choice = dynamic_cast<juce::AudioParameterChoice*>(parameter))
+        {
+            // getValueForText quietly picks the first choice for unknown names
+            if (! choice->choices.contains(text, true))
+                return juce::Result::fail("\"" + text + "\" is not one of " + choice->choices.joinIntoString(", "));
+
+            value = parameter->convertTo0to1(static_cast<float>(choice->choices.indexOf(text, true)));
+        }
+        else
+        {
+            value = parameter->getValueForText(text);
+        }
+
+        parameter->setValueNotifyingHost(value);
+        return juce::Result::ok();
+    }
+
+    /** Applies every "--set id=value" pair on the command line, in order. */
+    inline juce::Result applyParameters (juce::AudioProcessorValueTreeState& state, const juce::ArgumentList& args)
+    {
+        for (int i = 0; i < args.size(); ++i)
+        {
+            if (args[i].text != "--set")
+                continue;
+
+            if (i + 1 >= args.size())
+                return juce::Result::fail("--set needs an id=value argument");
+
+            const auto result = applyParameter(state, args[++i].text);
+
+            if (result.failed())
+                return result;
+        }
+
+        return juce::Result::ok();
+    }
+
+    /** Prints every parameter id with its current value, and the options for choices. */
+    inline void printParameters (juce::AudioProcessor& processor)
+    {
+        for (auto* parameter : processor.getParameters())
+        {
+            auto* ranged = dynamic_cast<juce::RangedAudioParameter*>(parameter);
+
+            if (ranged == nullptr)
+                continue;
+
+            std::cout << "\"" << ranged->paramID << "\" = " << ranged->getCurrentValueAsText();
+
+            if (auto* choice = dynamic_cast<juce::AudioParameterChoice*>(ranged))
+                std::cout << "  [" << choice->choices.joinIntoString(", ") << "]";
+            else if (dynamic_cast<juce::AudioParameterFloat*>(ranged) != nullptr)
+                std::cout << "  [" << ranged->getNormalisableRange().start << " .. " << ranged->getNormalisableRange().end << "]";
+
+            std::cout << std::endl;
+        }
+    }
+
+    /** Fills the buffer with a repeatable test signal around -6 dBFS: a few partials plus a little noise,
+        so every model has both steady tones and broadband content to chew on.
+    */
+    inline void fillTestSignal (juce::AudioBuffer<float>& buffer, double sampleRate, juce::int64 seed = 1)
+    {
+        juce::Random random (seed);
+        const double frequencies[] = { 110.0, 440.0, 1760.0, 5274.0 };
+
+        for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+        {
+            float* data = buffer.getWritePointer(ch);
+
+            for (int sample = 0; sample < buffer.getNumSamples(); ++sample)
+            {
+                double value = 0.0;
+
+                for (auto frequency : frequencies)
+                    value += 0.1 * std::sin(juce::MathConstants<double>::twoPi * frequency * sample / sampleRate + ch);
+
+                data[sample] = static_cast<float>(value) + 0.05f * (random.nextFloat() * 2.0f - 1.0f);
+            }
+        }
+    }
+
+    /** Sets up the buses, rate and block size and calls prepareToPlay, as a host does before playback. */
+    inline juce::Result prepareProcessor (juce::AudioProcessor& processor, double sampleRate, int blockSize, int numChannels, bool nonRealtime)
+    {
+        juce::AudioProcessor::BusesLayout layout;
+        layout.inputBuses.add(juce::AudioChannelSet::canonicalChannelSet(numChannels));
+        layout.outputBuses.add(juce::AudioChannelSet::canonicalChannelSet(numChannels));
+
+        if (! processor.setBusesLayout(layout))
+            return juce::Result::fail("the processor doesn't support " + juce::String(numChannels) + " channels");
+
+        processor.setNonRealtime(nonRealtime);
+        processor.setRateAndBufferSizeDetails(sampleRate, blockSize);
+        processor.prepareToPlay(sampleRate, blockSize);
+        return juce::Result::ok();
+    }
+}
@@ -0,0 +1,298 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    DistortionStress
+
+    Multi-instance stress test. Builds N processors and runs them from a pool
+    of worker threads the way a DAW graph does: every callback period, all
+    instances are handed to the pool, and the callback is complete when the
+    last one has finished. The audio thread takes part in the work, as it
+    does in most hosts.
+
+    Reports total throughput, p50/p99/p99.9 callback times and the number of
+    callbacks that missed the buffer period. Run it with increasing instance
+    and thread counts to find where the scaling stops.
+
+      DistortionStress [--instances 64] [--threads <num cpus>]
+                       [--block-size 128] [--sample-rate 48000]
+                       [--seconds 10] [--realtime] [--set "id=value"]...
+                       [--output results.json]
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+#include "../Shared/ToolHelpers.h"
+#include <numeric>
+
+namespace
+{
+    //==============================================================================
+    /** N processors and the threads that run them, one callback at a time. */
+    class InstanceGraph
+    {
+    public:
+        InstanceGraph (int numInstances, int numThreads, const juce::AudioBuffer<float>& sourceToUse)
+            : source (sourceToUse)
+        {
+            // each instance gets its own allocations, as it would in a host
+            for (int i = 0; i < numInstances; ++i)
+                instances.push_back(std::make_unique<Instance>());
+
+            // the calling thread is one of the workers
+            for (int i = 1; i < numThreads; ++i)
+                workers.push_back(std::make_unique<Worker>(*this, i));
+        }
+
+        ~InstanceGraph()
+        {
+            for (auto& worker : workers)
+                worker->signalThreadShouldExit();
+
+            for (auto& worker : workers)
+            {
+                worker->start.signal();
+                worker->stopThread(2000);
+            }
+        }
+
+        juce::Result prepare (const juce::ArgumentList& args, double sampleRate, int blockSize)
+        {
+            for (auto& instance : instances)
+            {
+                // timed the way a host runs it with no editor open, without paying for measurements
+                instance->processor.getInstrumentation().setEnabled(false);
+
+                const auto parameters = ToolHelpers::applyParameters(instance->processor.treeState, args);
+
+                if (parameters.failed())
+                    return parameters;
+
+                const auto prepared = ToolHelpers::prepareProcessor(instance->processor, sampleRate, blockSize,
+                                                                    source.getNumChannels(), false);
+
+                if (prepared.failed())
+                    return prepared;
+
+                instance->buffer.setSize(source.getNumChannels(), blockSize);
+            }
+
+            numSamples = blockSize;
+
+            for (auto& worker : workers)
+                worker->startThread();
+
+            return juce::Result::ok();
+        }
+
+        /** Runs every instance once and returns when they have all finished. */
+        void processCallback()
+        {
+            sourcePosition = (sourcePosition + numSamples) % (source.getNumSamples() - numSamples);
+
+            // remaining is set first, so a worker still finishing the last callback can't claim work before it's counted
+            remaining = static_cast<int>(instances.size());
+            nextInstance = 0;
+
+            for (auto& worker : workers)
+                worker->start.signal();
+
+            processInstances();
+            finished.wait(-1);
+        }
+
+        int getNumInstances() const noexcept    { return static_cast<int>(instances.size()); }
+        int getLatencySamples() const noexcept  { return instances.front()->processor.getLatencySamples(); }
+
+    private:
+        // padded to a cache line, so neighbouring instances don't share one
+        struct alignas(64) Instance
+        {
+            DistortionOversamplingAudioProcessor processor;
+            juce::AudioBuffer<float> buffer;
+            juce::MidiBuffer midi;
+        };
+
+        struct Worker  : public juce::Thread
+        {
+            Worker (InstanceGraph& g, int index)
+                : juce::Thread ("Stress worker " + juce::String(index)), graph (g) {}
+
+            void run() override
+            {
+                while (! threadShouldExit())
+                {
+                    start.wait(-1);
+
+                    if (threadShouldExit())
+                        break;
+
+                    graph.processInstances();
+                }
+            }
+
+            InstanceGraph& graph;
+            juce::WaitableEvent start;
+        };
+
+        void processInstances()
+        {
+            // instances are claimed one at a time, so a slow one doesn't hold up the rest of the queue
+            for (;;)
+            {
+                const auto index = nextInstance.fetch_add(1);
+
+                if (index >= static_cast<int>(instances.size()))
+                    return;
+
+                auto& instance = *instances[static_cast<size_t>(index)];
+
+                for (int ch = 0; ch < source.getNumChannels(); ++ch)
+                    instance.buffer.copyFrom(ch, 0, source, ch, sourcePosition, numSamples);
+
+                instance.processor.processBlock(instance.buffer, instance.midi);
+
+                if (remaining.fetch_sub(1) == 1)
+                    finished.signal();
+            }
+        }
+
+        const juce::AudioBuffer<float>& source;
+        std::vector<std::unique_ptr<Instance>> instances;
+        std::vector<std::unique_ptr<Worker>> workers;
+
+        int numSamples = 0;
+        int sourcePosition = 0;
+
+        alignas(64) std::atomic<int> nextInstance {0};
+        alignas(64) std::atomic<int> remaining {0};
+        juce::WaitableEvent finished;
+    };
+
+    double percentile (const std::vector<double>& sorted, double fraction)
+    {
+        const auto index = static_cast<size_t>(std::ceil(fraction * static_cast<double>(sorted.size()))) - 1;
+        return sorted[juce::jlimit<size_t>(0, sorted.size() - 1, index)];
+    }
+
+    //==============================================================================
+    int runStress (const juce::ArgumentList& args)
+    {
+        const auto numInstances = args.containsOption("--instances") ? args.getValueForOption("--instances").getIntValue() : 64;
+        const auto numThreads = args.containsOption("--threads") ? args.getValueForOption("--threads").getIntValue() : juce::SystemStats::getNumCpus();
+        const auto blockSize = args.containsOption("--block-size") ? args.getValueForOption("--block-size").getIntValue() : 128;
+        const auto sampleRate = args.containsOption("--sample-rate") ? args.getValueForOption("--sample-rate").getDoubleValue() : 48000.0;
+        const auto seconds = args.containsOption("--seconds") ? args.getValueForOption("--seconds").getDoubleValue() : 10.0;
+        const auto realtime = args.containsOption("--realtime");
+
+        if (numInstances <= 0 || numThreads <= 0 || blockSize <= 0 || sampleRate <= 0.0 || seconds <= 0.0)
+            juce::ConsoleApplication::fail("--instances, --threads, --block-size, --sample-rate and --seconds must be positive");
+
+        juce::AudioBuffer<float> source (2, static_cast<int>(sampleRate) + blockSize);
+        ToolHelpers::fillTestSignal(source, sampleRate);
+
+        InstanceGraph graph (numInstances, numThreads, source);
+        const auto prepared = graph.prepare(args, sampleRate, blockSize);
+
+        if (prepared.failed())
+            juce::ConsoleApplication::fail(prepared.getErrorMessage());
+
+        const auto period = static_cast<double>(blockSize) / sampleRate;
+        const auto numCallbacks = juce::jmax(1, static_cast<int>(seconds / period));
+
+        // warm up, then measure
+        for (int i = 0; i < juce::jmin(numCallbacks, 100); ++i)
+            graph.processCallback();
+
+        std::vector<double> callbackTimes;
+        callbackTimes.reserve(static_cast<size_t>(numCallbacks));
+
+        int deadlineMisses = 0;
+        const auto ticksPerSecond = static_cast<double>(juce::Time::getHighResolutionTicksPerSecond());
+        const auto periodTicks = static_cast<juce::int64>(period * ticksPerSecond);
+        const auto startTicks = juce::Time::getHighResolutionTicks();
+        auto nextCallbackTicks = startTicks;
+
+        for (int i = 0; i < numCallbacks; ++i)
+        {
+            // in real time mode each callback waits for its slot, like a sound card interrupt
+            if (realtime)
+            {
+                while (juce::Time::getHighResolutionTicks() < nextCallbackTicks - ticksPerSecond / 2000)
+                    juce::Thread::sleep(0);
+
+                while (juce::Time::getHighResolutionTicks() < nextCallbackTicks) {}
+
+                nextCallbackTicks += periodTicks;
+            }
+
+            const auto callbackStart = juce::Time::getHighResolutionTicks();
+            graph.processCallback();
+            const auto elapsed = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - callbackStart);
+
+            callbackTimes.push_back(elapsed);
+
+            if (elapsed > period)
+                ++deadlineMisses;
+        }
+
+        const auto wallSeconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+        const auto busySeconds = std::accumulate(callbackTimes.begin(), callbackTimes.end(), 0.0);
+        std::sort(callbackTimes.begin(), callbackTimes.end());
+
+        // throughput counts only time spent in callbacks, so real time pacing doesn't dilute it
+        const auto samplesProcessed = static_cast<double>(numCallbacks) * blockSize * numInstances;
+        const auto instanceSecondsPerSecond = samplesProcessed / sampleRate / busySeconds;
+
+        auto* result = new juce::DynamicObject();
+        result->setProperty("instances", numInstances);
+        result->setProperty("threads", numThreads);
+        result->setProperty("block_size", blockSize);
+        result->setProperty("sample_rate", sampleRate);
+        result->setProperty("realtime", realtime);
+        result->setProperty("instrumentation", false);
+        result->setProperty("latency_samples", graph.getLatencySamples());
+        result->setProperty("callbacks", numCallbacks);
+        result->setProperty("period_ms", period * 1000.0);
+        result->setProperty("p50_ms", percentile(callbackTimes, 0.5) * 1000.0);
+        result->setProperty("p99_ms", percentile(callbackTimes, 0.99) * 1000.0);
+        result->setProperty("p999_ms", percentile(callbackTimes, 0.999) * 1000.0);
+        result->setProperty("max_ms", callbackTimes.back() * 1000.0);
+        result->setProperty("deadline_misses", deadlineMisses);
+        result->setProperty("ns_per_sample", busySeconds * 1.0e9 / samplesProcessed);
+        result->setProperty("realtime_instances", instanceSecondsPerSecond);
+        result->setProperty("wall_seconds", wallSeconds);
+        const juce::var json (result);
+
+        std::cout << numInstances << " instances on " << numThreads << " threads, "
+                  << blockSize << " samples at " << sampleRate << " Hz (period " << period * 1000.0 << " ms)" << std::endl
+                  << "callback p50 " << percentile(callbackTimes, 0.5) * 1000.0 << " ms, p99 "
+                  << percentile(callbackTimes, 0.99) * 1000.0 << " ms, p99.9 "
+                  << percentile(callbackTimes, 0.999) * 1000.0 << " ms, max " << callbackTimes.back() * 1000.0 << " ms" << std::endl
+                  << deadlineMisses << " of " << numCallbacks << " callbacks missed the deadline" << std::endl
+                  << "throughput: " << instanceSecondsPerSecond << " instances' worth of real time" << std::endl;
+
+        if (args.containsOption("--output"))
+        {
+            const auto outputFile = args.getFileForOption("--output");
+
+            if (! outputFile.replaceWithText(juce::JSON::toString(json)))
+                juce::ConsoleApplication::fail("couldn't write " + outputFile.getFullPathName());
+        }
+
+        return 0;
+    }
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    // the parameter state wants a message manager, even with no editor
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::ArgumentList args (argc, argv);
+
+    return juce::ConsoleApplication::invokeCatchingFailures([&] { return runStress(args); });
+}